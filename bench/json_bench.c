@@ -0,0 +1,565 @@
+/* Benchmark suite for libjson
+ *
+ * Build (from repository root), where the ladle/common headers are installed under
+ * LADLE_INCLUDE:
+ *     make bench LADLE_INCLUDE=/usr/local/include
+ * or
+ *     cc -std=c11 -O2 -DNDEBUG -I$LADLE_INCLUDE -o json_bench bench/json_bench.c json.c -lm
+ *
+ * Usage:
+ *     json_bench [scale] [iterations]
+ *
+ * Results are written to stdout as JSON Lines, one record per benchmark:
+ *     {"bench": ..., "corpus": ..., "scale": ..., "bytes": ..., "iters": ...,
+ *      "mb_per_s": ..., "ops_per_s": ..., "p50_ns": ..., "p90_ns": ...,
+ *      "p99_ns": ..., "max_ns": ..., "peak_rss_kb": ...}
+ *
+ * When json.c is also compiled with -DJSON_STATS, a final "stats" record
+ * reports the library-wide counters returned by json_stats(). */
+#define _POSIX_C_SOURCE 200809L
+#include <errno.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <sys/resource.h>
+#include "../json.h"
+
+// Default number of entries in each generated corpus
+#define BENCH_DEFSCALE  10000
+
+// Default number of timed iterations per benchmark
+#define BENCH_DEFITERS  50
+
+// Maximum depth of nested corpus
+#define BENCH_MAXDEPTH  64
+
+// Corpus used as input for a set of benchmarks
+typedef struct bcorpus_t {
+    const char *name;
+    FILE *file;     // Serialized document
+    size_t bytes;   // Size of serialized document
+    json_t *json;   // Document constructed through json_add()
+} bcorpus_t;
+
+// Timing samples of a single benchmark
+typedef struct bresult_t {
+    size_t iters, ops, bytes;   // ops and bytes are per iteration
+    uint64_t *samples;          // Nanoseconds per iteration
+} bresult_t;
+
+// Returns monotonic time in nanoseconds
+static uint64_t bench_now(void) {
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t) ts.tv_sec * 1000000000u + (uint64_t) ts.tv_nsec;
+}
+
+// Returns peak resident set size in kilobytes
+static long bench_peak_rss(void) {
+    struct rusage usage;
+
+    if (getrusage(RUSAGE_SELF, &usage))
+        return -1;
+    return usage.ru_maxrss;
+}
+
+// Comparison function for qsort() of samples
+static int bench_samplecmp(const void *sample1, const void *sample2) {
+    const uint64_t LHS = *(const uint64_t *) sample1;
+    const uint64_t RHS = *(const uint64_t *) sample2;
+
+    return (LHS > RHS) - (LHS < RHS);
+}
+
+// Returns given percentile of sorted samples
+static uint64_t bench_percentile(const bresult_t *result, unsigned pct) {
+    size_t index = result->iters * pct / 100;
+
+    if (index >= result->iters)
+        index = result->iters - 1;
+    return result->samples[index];
+}
+
+// Writes single result record as a JSON line
+static void bench_report(const char *bench,
+  const bcorpus_t *corpus, size_t scale, bresult_t *result) {
+    uint64_t total = 0;
+
+    qsort(result->samples, result->iters, sizeof(uint64_t), bench_samplecmp);
+    for (size_t i = 0; i < result->iters; ++i)
+        total += result->samples[i];
+    if (!total)     // Clock resolution too coarse
+        total = 1;
+
+    const double SECONDS = (double) total / 1e9;
+
+    printf("{\"bench\": \"%s\", \"corpus\": \"%s\", \"scale\": %zu, "
+      "\"bytes\": %zu, \"iters\": %zu, \"mb_per_s\": %.3f, "
+      "\"ops_per_s\": %.1f, \"p50_ns\": %llu, \"p90_ns\": %llu, "
+      "\"p99_ns\": %llu, \"max_ns\": %llu, \"peak_rss_kb\": %ld}\n",
+      bench, corpus ? corpus->name : "synthetic", scale,
+      result->bytes, result->iters,
+      (double) result->bytes * result->iters / SECONDS / 1e6,
+      (double) result->ops * result->iters / SECONDS,
+      (unsigned long long) bench_percentile(result, 50),
+      (unsigned long long) bench_percentile(result, 90),
+      (unsigned long long) bench_percentile(result, 99),
+      (unsigned long long) result->samples[result->iters - 1],
+      bench_peak_rss());
+    fflush(stdout);
+}
+
+// Reports failure of library call on corpus
+static void bench_fail(const char *call, const bcorpus_t *corpus) {
+    fprintf(stderr, "json_bench: %s() failed on '%s': %s\n",
+      call, corpus->name, strerror(errno));
+}
+
+// Writes key of given index to buffer
+static void bench_key(char *buffer, size_t size, const char *prefix, size_t index) {
+    snprintf(buffer, size, "%s%08zu", prefix, index);
+}
+
+// Writes array of numbers, both serialized and as object
+static bool corpus_numbers(bcorpus_t *corpus, size_t scale) {
+    jarray_t *array = jarray_new();
+
+    if (!array)     // jarray_new() fails
+        return false;
+    fputs("{\"data\": [", corpus->file);
+    for (size_t i = 0; i < scale; ++i) {
+        const jvalue_t VALUE =
+          {.type = J_NUM, .value = {.number = (jfloat_t) i * 1.25 - 3e3}};
+
+        fprintf(corpus->file, "%s%.17g", i ? ", " : "", (double) VALUE.value.number);
+        if (!jarray_pushb(array, &VALUE)) {
+            jarray_free(array);
+            return false;
+        }   // jarray_pushb() fails
+    }
+    fputs("]}", corpus->file);
+
+    const jvalue_t DATA = {.type = J_ARR, .value = {.array = array}};
+    const bool SUCCESS = json_add(corpus->json, "data", &DATA);
+
+    jarray_free(array);
+    return SUCCESS;
+}
+
+// Writes objects nested up to BENCH_MAXDEPTH levels, 'scale' entries in total
+static bool corpus_nested(bcorpus_t *corpus, size_t scale) {
+    const size_t WIDTH = scale / BENCH_MAXDEPTH + 1;
+    json_t *levels[BENCH_MAXDEPTH];
+    char key[32];
+
+    for (size_t depth = 0; depth < BENCH_MAXDEPTH; ++depth) {
+        fputs("{", corpus->file);
+        levels[depth] = depth ? json_new() : corpus->json;
+        if (!levels[depth]) {
+            while (--depth)
+                json_free(levels[depth]);
+            return false;
+        }   // json_new() fails
+        for (size_t i = 0; i < WIDTH; ++i) {
+            const jvalue_t VALUE = {.type = J_BOOL, .value = {.boolean = i & 1}};
+
+            bench_key(key, sizeof key, "leaf", i);
+            fprintf(corpus->file, "%s\"%s\": %s",
+              i ? ", " : "", key, i & 1 ? "true" : "false");
+            json_add(levels[depth], key, &VALUE);
+        }
+        if (depth != BENCH_MAXDEPTH - 1)
+            fputs(", \"child\": ", corpus->file);
+    }
+    for (size_t depth = BENCH_MAXDEPTH - 1; depth; --depth) {
+        const jvalue_t CHILD = {.type = J_OBJ, .value = {.object = levels[depth]}};
+        const bool SUCCESS = json_add(levels[depth - 1], "child", &CHILD);
+
+        json_free(levels[depth]);
+        if (!SUCCESS) {
+            while (--depth)
+                json_free(levels[depth]);
+            return false;
+        }   // json_add() fails
+        fputs("}", corpus->file);
+    }
+    fputs("}", corpus->file);
+    return true;
+}
+
+// Writes few keys mapped to long strings, resembling log lines and HTML fragments
+static bool corpus_strings(bcorpus_t *corpus, size_t scale) {
+    static const char TEXT[] =      // Quotes, backslashes, control characters, UTF-8
+      "<p class=\"log\">Lorem ipsum dolor sit amet, consectetur adipiscing elit, "
+      "sed do eiusmod tempor C:\\var\\log\tcaf\xC3\xA9 na\xC3\xAFve \xE6\x97\xA5\xE6\x9C\xAC"
+      " \xF0\x9F\x93\x9D\x1B[0m incididunt ut labore et dolore magna aliqua</p>\n";
+    static const char ESCAPED[] =   // TEXT as it appears within a JSON string
+      "<p class=\\\"log\\\">Lorem ipsum dolor sit amet, consectetur adipiscing elit, "
+      "sed do eiusmod tempor C:\\\\var\\\\log\\tcaf\xC3\xA9 na\xC3\xAFve \xE6\x97\xA5\xE6\x9C\xAC"
+      " \xF0\x9F\x93\x9D\\u001b[0m incididunt ut labore et dolore magna aliqua</p>\\n";
+    char key[32], *buffer = malloc(sizeof TEXT * 8);
+
+    if (!buffer)    // malloc() fails
+        return false;
+    buffer[0] = '\0';
+    for (size_t i = 0; i < 8; ++i)
+        strcat(buffer, TEXT);
+    fputs("{", corpus->file);
+    for (size_t i = 0; i < scale / 8 + 1; ++i) {
+        const jvalue_t VALUE = {.type = J_STR, .value = {.string = buffer}};
+
+        bench_key(key, sizeof key, "s", i);
+        fprintf(corpus->file, "%s\"%s\": \"", i ? ", " : "", key);
+        for (size_t j = 0; j < 8; ++j)
+            fputs(ESCAPED, corpus->file);
+        fputs("\"", corpus->file);
+        if (!json_add(corpus->json, key, &VALUE)) {
+            free(buffer);
+            return false;
+        }   // json_add() fails
+    }
+    fputs("}", corpus->file);
+    free(buffer);
+    return true;
+}
+
+// Writes many dotted keys mapped to numbers
+static bool corpus_keys(bcorpus_t *corpus, size_t scale) {
+    char key[48];
+
+    fputs("{", corpus->file);
+    for (size_t i = 0; i < scale; ++i) {
+        const jvalue_t VALUE = {.type = J_NUM, .value = {.number = (jfloat_t) i}};
+
+        bench_key(key, sizeof key, i & 1 ? "metrics.host." : "metrics.disk.", i);
+        fprintf(corpus->file, "%s\"%s\": %zu", i ? ", " : "", key, i);
+        if (!json_add(corpus->json, key, &VALUE))
+            return false;
+    }
+    fputs("}", corpus->file);
+    return true;
+}
+
+/* Generates named corpus of given scale
+ * Returns false on error */
+static bool corpus_new(bcorpus_t *corpus, const char *name,
+  bool (*generate)(bcorpus_t *, size_t), size_t scale) {
+    corpus->name = name;
+    corpus->file = tmpfile();
+    if (!corpus->file)      // tmpfile() fails
+        return false;
+    corpus->json = json_new();
+    if (!corpus->json) {
+        fclose(corpus->file);
+        return false;
+    }   // json_new() fails
+    if (!generate(corpus, scale)) {
+        json_free(corpus->json);
+        fclose(corpus->file);
+        return false;
+    }   // generate() fails
+    corpus->bytes = (size_t) ftell(corpus->file);
+    return true;
+}
+
+static void corpus_free(bcorpus_t *corpus) {
+    json_free(corpus->json);
+    fclose(corpus->file);
+}
+
+static void bench_parse(const bcorpus_t *corpus, bresult_t *result) {
+    for (size_t i = 0; i < result->iters; ++i) {
+        rewind(corpus->file);
+
+        const uint64_t START = bench_now();
+        json_t *json = json_parse(corpus->file);
+
+        result->samples[i] = bench_now() - START;
+        if (!json) {
+            bench_fail("json_parse", corpus);
+            break;
+        }   // json_parse() fails
+        json_free(json);
+    }
+    result->ops = 1;
+    result->bytes = corpus->bytes;
+}
+
+// Validates serialized corpus, read into memory beforehand
+static void bench_validate(const bcorpus_t *corpus, bresult_t *result) {
+    char *buffer = malloc(corpus->bytes ? corpus->bytes : 1);
+    size_t offset;
+
+    if (!buffer) {
+        perror("json_bench");
+        return;
+    }   // malloc() fails
+    rewind(corpus->file);
+    if (fread(buffer, 1, corpus->bytes, corpus->file) != corpus->bytes)
+        fprintf(stderr, "json_bench: failed to read '%s'\n", corpus->name);
+    for (size_t i = 0; i < result->iters; ++i) {
+        const uint64_t START = bench_now();
+
+        if (!json_validate(buffer, corpus->bytes, &offset))
+            fprintf(stderr, "json_bench: '%s' invalid at byte %zu\n", corpus->name, offset);
+        result->samples[i] = bench_now() - START;
+    }
+    free(buffer);
+    result->ops = 1;
+    result->bytes = corpus->bytes;
+}
+
+static void bench_print(const bcorpus_t *corpus, bresult_t *result, FILE *sink) {
+    for (size_t i = 0; i < result->iters; ++i) {
+        rewind(sink);
+
+        const uint64_t START = bench_now();
+
+        json_print(corpus->json, sink, 0);
+        fflush(sink);
+        result->samples[i] = bench_now() - START;
+    }
+    result->ops = 1;
+    result->bytes = (size_t) ftell(sink);
+}
+
+static void bench_copy_free(const bcorpus_t *corpus,
+  bresult_t *copy_result, bresult_t *free_result) {
+    for (size_t i = 0; i < copy_result->iters; ++i) {
+        uint64_t start = bench_now();
+        json_t *json = json_copy(corpus->json);
+
+        copy_result->samples[i] = bench_now() - start;
+        if (!json) {
+            bench_fail("json_copy", corpus);
+            break;
+        }   // json_copy() fails
+        start = bench_now();
+        json_free(json);
+        free_result->samples[i] = bench_now() - start;
+    }
+    copy_result->ops = free_result->ops = 1;
+    copy_result->bytes = free_result->bytes = corpus->bytes;
+}
+
+// Hashes fresh copies of corpus, then compares them against it
+static void bench_hash_equal(const bcorpus_t *corpus,
+  bresult_t *hash_result, bresult_t *equal_result) {
+    for (size_t i = 0; i < hash_result->iters; ++i) {
+        json_t *json = json_copy(corpus->json);
+
+        if (!json) {
+            bench_fail("json_copy", corpus);
+            break;
+        }   // json_copy() fails
+
+        uint64_t start = bench_now();
+
+        json_hash(json);
+        hash_result->samples[i] = bench_now() - start;
+        start = bench_now();
+        if (!json_equal(corpus->json, json))
+            fprintf(stderr, "json_bench: copy of '%s' differs\n", corpus->name);
+        equal_result->samples[i] = bench_now() - start;
+        json_free(json);
+    }
+    hash_result->ops = equal_result->ops = 1;
+    hash_result->bytes = equal_result->bytes = corpus->bytes;
+}
+
+// Merges corpus into fresh copies of itself
+static void bench_merge(const bcorpus_t *corpus, bresult_t *result) {
+    for (size_t i = 0; i < result->iters; ++i) {
+        json_t *json = json_copy(corpus->json);
+
+        if (!json) {
+            bench_fail("json_copy", corpus);
+            break;
+        }   // json_copy() fails
+
+        const uint64_t START = bench_now();
+
+        json_merge(json, corpus->json);
+        result->samples[i] = bench_now() - START;
+        json_free(json);
+    }
+    result->ops = 1;
+    result->bytes = corpus->bytes;
+}
+
+// Looks up every key of key-heavy corpus
+static void bench_find(const bcorpus_t *corpus, bresult_t *result, size_t scale) {
+    char key[48];
+
+    for (size_t i = 0; i < result->iters; ++i) {
+        const uint64_t START = bench_now();
+
+        for (size_t j = 0; j < scale; ++j) {
+            const size_t INDEX = (j * 7919) % scale;   // Non-sequential access
+
+            bench_key(key, sizeof key,
+              INDEX & 1 ? "metrics.host." : "metrics.disk.", INDEX);
+            if (!json_find(corpus->json, key))
+                fprintf(stderr, "json_bench: missing key '%s'\n", key);
+        }
+        result->samples[i] = bench_now() - START;
+    }
+    result->ops = scale;
+}
+
+// Adds, then removes, 'scale' new keys to key-heavy corpus
+static void bench_add_remove(const bcorpus_t *corpus,
+  bresult_t *add_result, bresult_t *remove_result, size_t scale) {
+    const jvalue_t VALUE = {.type = J_NUM, .value = {.number = 1}};
+    char key[48];
+
+    for (size_t i = 0; i < add_result->iters; ++i) {
+        uint64_t start = bench_now();
+
+        for (size_t j = 0; j < scale; ++j) {
+            bench_key(key, sizeof key, "metrics.new.", j);
+            json_add(corpus->json, key, &VALUE);
+        }
+        add_result->samples[i] = bench_now() - start;
+        start = bench_now();
+        for (size_t j = 0; j < scale; ++j) {
+            bench_key(key, sizeof key, "metrics.new.", j);
+            json_remove(corpus->json, key);
+        }
+        remove_result->samples[i] = bench_now() - start;
+    }
+    add_result->ops = remove_result->ops = scale;
+}
+
+// Exercises jarray_*() operations on an array of 'scale' numbers
+static void bench_jarray(bresult_t *results, size_t scale) {
+    const jvalue_t VALUE = {.type = J_NUM, .value = {.number = 2}};
+
+    for (size_t i = 0; i < results[0].iters; ++i) {
+        jarray_t *array = jarray_new();
+        uint64_t start = bench_now();
+
+        for (size_t j = 0; j < scale; ++j)
+            jarray_pushb(array, &VALUE);
+        results[0].samples[i] = bench_now() - start;
+        start = bench_now();
+        for (size_t j = 0; j < scale; ++j)
+            jarray_get(array, (j * 7919) % scale);
+        results[1].samples[i] = bench_now() - start;
+        start = bench_now();
+        for (size_t j = 0; j < scale; ++j)
+            jvalue_free(jarray_popb(array));
+        results[2].samples[i] = bench_now() - start;
+
+        const size_t FRONT = scale / 16 + 1;    // Front operations are O(n)
+
+        start = bench_now();
+        for (size_t j = 0; j < FRONT; ++j)
+            jarray_pushf(array, &VALUE);
+        results[3].samples[i] = bench_now() - start;
+        start = bench_now();
+        for (size_t j = 0; j < FRONT; ++j)
+            jvalue_free(jarray_popf(array));
+        results[4].samples[i] = bench_now() - start;
+        for (size_t j = 0; j < FRONT; ++j)
+            jarray_pushb(array, &VALUE);
+        start = bench_now();
+        while (array->size)
+            jarray_remove(array, array->size / 2);
+        results[5].samples[i] = bench_now() - start;
+        jarray_free(array);
+    }
+    results[0].ops = results[1].ops = results[2].ops = scale;
+    results[3].ops = results[4].ops = results[5].ops = scale / 16 + 1;
+}
+
+int main(int argc, char **argv) {
+    const size_t SCALE = argc > 1 ? strtoull(argv[1], NULL, 10) : BENCH_DEFSCALE;
+    const size_t ITERS = argc > 2 ? strtoull(argv[2], NULL, 10) : BENCH_DEFITERS;
+    static const char *const JARRAY_NAMES[] = {
+        "jarray_pushb", "jarray_get", "jarray_popb",
+        "jarray_pushf", "jarray_popf", "jarray_remove"
+    };
+    static const struct {
+        const char *name;
+        bool (*generate)(bcorpus_t *, size_t);
+    } CORPORA[] = {
+        {"numbers", corpus_numbers},
+        {"nested",  corpus_nested},
+        {"strings", corpus_strings},
+        {"keys",    corpus_keys}
+    };
+    bresult_t results[6];
+    FILE *sink = tmpfile();
+
+    if (!SCALE || !ITERS) {
+        fprintf(stderr, "usage: %s [scale] [iterations]\n", argv[0]);
+        return EXIT_FAILURE;
+    }
+    if (!sink) {
+        perror("json_bench");
+        return EXIT_FAILURE;
+    }   // tmpfile() fails
+    for (size_t i = 0; i < 6; ++i) {
+        results[i].iters = ITERS;
+        results[i].bytes = 0;
+        results[i].samples = calloc(ITERS, sizeof(uint64_t));
+        if (!results[i].samples) {
+            perror("json_bench");
+            return EXIT_FAILURE;
+        }   // calloc() fails
+    }
+    for (size_t i = 0; i < sizeof CORPORA / sizeof CORPORA[0]; ++i) {
+        bcorpus_t corpus;
+
+        if (!corpus_new(&corpus, CORPORA[i].name, CORPORA[i].generate, SCALE)) {
+            perror("json_bench");
+            return EXIT_FAILURE;
+        }   // corpus_new() fails
+        bench_parse(&corpus, results);
+        bench_report("json_parse", &corpus, SCALE, results);
+        bench_validate(&corpus, results);
+        bench_report("json_validate", &corpus, SCALE, results);
+        bench_print(&corpus, results, sink);
+        bench_report("json_print", &corpus, SCALE, results);
+        bench_copy_free(&corpus, results, results + 1);
+        bench_report("json_copy", &corpus, SCALE, results);
+        bench_report("json_free", &corpus, SCALE, results + 1);
+        bench_hash_equal(&corpus, results, results + 1);
+        bench_report("json_hash", &corpus, SCALE, results);
+        bench_report("json_equal", &corpus, SCALE, results + 1);
+        bench_merge(&corpus, results);
+        bench_report("json_merge", &corpus, SCALE, results);
+        if (!strcmp(corpus.name, "keys")) {
+            results[0].bytes = results[1].bytes = 0;
+            bench_find(&corpus, results, SCALE);
+            bench_report("json_find", &corpus, SCALE, results);
+            bench_add_remove(&corpus, results, results + 1, SCALE);
+            bench_report("json_add", &corpus, SCALE, results);
+            bench_report("json_remove", &corpus, SCALE, results + 1);
+        }
+        corpus_free(&corpus);
+    }
+    for (size_t i = 0; i < 6; ++i)
+        results[i].bytes = 0;
+    bench_jarray(results, SCALE);
+    for (size_t i = 0; i < 6; ++i) {
+        bench_report(JARRAY_NAMES[i], NULL, SCALE, results + i);
+        free(results[i].samples);
+    }
+    fclose(sink);
+#ifdef JSON_STATS
+    const jstats_t STATS = json_stats();
+
+    printf("{\"bench\": \"stats\", \"allocs\": %zu, \"frees\": %zu, "
+      "\"rotations\": %zu, \"comparisons\": %zu, "
+      "\"parse_ns\": %llu, \"print_ns\": %llu}\n",
+      STATS.allocs, STATS.frees, STATS.rotations, STATS.comparisons,
+      (unsigned long long) STATS.parse_ns, (unsigned long long) STATS.print_ns);
+#endif
+
+    return EXIT_SUCCESS;
+}
@@ -1,12 +1,35 @@
+#define _POSIX_C_SOURCE 200809L    // strdup()
 #include <errno.h>
 #include <math.h>
+#include <stdatomic.h>
 #include <stdlib.h>
 #include <string.h>
 #include <stdarg.h>
 #include <stdio.h>
 #include <stdint.h>
+#include <time.h>
 #include "json.h"
 
+// SSE2 kernels, available on every x86-64 target
+#if !defined(JSON_NO_SIMD) && (defined(__SSE2__) || \
+  defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2))
+#define JSON_SSE2
+#include <emmintrin.h>
+#endif
+
+// Returns index of lowest set bit of non-zero mask
+#ifdef _MSC_VER
+#include <intrin.h>
+static unsigned jbit_ctz(unsigned mask) {
+    unsigned long index;
+
+    _BitScanForward(&index, mask);
+    return index;
+}
+#else
+#define jbit_ctz(mask)  ((unsigned) __builtin_ctz(mask))
+#endif
+
 // Ensures portability of strdup
 #if !(defined(__unix__) || (defined(__APPLE__) && defined(__MACH__)))  // Not POSIX
 #ifdef _MSC_VER // Using Microsoft Visual C/C++
@@ -29,49 +52,123 @@ static char *strdup(const char *STRING) {
 // Error handler
 #define error(err, ret) { errno = err; return ret; }
 
+// Instrumentation, compiled out unless JSON_STATS is defined
+#ifdef JSON_STATS
+static jstats_t jstats;
+
+#define jstat_add(field, n)     (jstats.field += (n))
+#define jstat_alloc(kind, n)    (++jstats.allocs, jstats.held.kind += (n))
+#define jstat_free(kind, n)     (++jstats.frees, jstats.held.kind -= (n))
+#define jstat_start()           jstat_now()
+#define jstat_stop(field, start) \
+    (jstats.field##s += 1, jstats.field##_ns += jstat_now() - (start))
+
+// Returns current time in nanoseconds
+static uint64_t jstat_now(void) {
+    struct timespec ts;
+
+    timespec_get(&ts, TIME_UTC);
+    return (uint64_t) ts.tv_sec * 1000000000u + (uint64_t) ts.tv_nsec;
+}
+#else
+#define jstat_add(field, n)         ((void) 0)
+#define jstat_alloc(kind, n)        ((void) 0)
+#define jstat_free(kind, n)         ((void) 0)
+#define jstat_start()               ((uint64_t) 0)
+#define jstat_stop(field, start)    ((void) (start))
+#endif  // #ifdef JSON_STATS
+
 // Returns ceiling of jfloat_t
 #define jfloat_ceil(value)  \
     _Generic(value, double: ceil(value), long double: ceill(value))
 
+// Converts string to jfloat_t, as strtod()
+#define jfloat_strto(string, end)   \
+    _Generic((jfloat_t) 0, double: strtod, long double: strtold)(string, end)
+
+// Significant digits printed so that every jfloat_t is read back exactly
+#define JFLT_PRINT_DIG  (JFLT_MANT_DIG * 30103 / 100000 + 2)
+
+// Longest number printed, counting sign, point, exponent and terminator
+#define JFLT_PRINTBUF   (JFLT_PRINT_DIG + 16)
+
+// Longest number converted without allocating
+#define JSCAN_NUMBUF    64
+
+// Bytes of an escaped string gathered before each write
+#define JSTRING_WRITEBUF    256
+
+// Longest escape sequence written for a single character
+#define JESCAPE_MAX     6
+
 // Returns balance factor of given entry
 #define json_factor(node)                                           \
     ((node->lchild ? (long long) node->lchild->height + 1 : 0) -    \
     (node->rchild ? (long long) node->rchild->height + 1 : 0))
 
+// Returns height of given entry according to its children
+#define json_height(node)                                               \
+    (node->lchild && (!node->rchild ||                                  \
+      node->lchild->height > node->rchild->height) ?                    \
+    node->lchild->height + 1 : node->rchild ? node->rchild->height + 1 : 0)
+
 // JSON entry
 typedef struct jentry_t {
     size_t height;
     char *key;
     jvalue_t *value;
-    jentry_t *parent, *lchild, *rchild;
+    struct jentry_t *parent, *lchild, *rchild;
 } jentry_t;
 
-// Info for json_seek() and json_lookup()
+// Info for json_seek()
 typedef struct jinfo_t {
-    int change;         // Change in height
-    jentry_t *target;   // Located entry
+    int dif;            // Comparison of key against key of parent
+    jentry_t *parent;   // Last entry visited before target
+    jentry_t *target;   // Located entry, or NULL if not found
 } jinfo_t;
 
-// Balances entry tree from given node
-static void json_balance(jentry_t *root) {
-    long long bal_factor;
+// Structural hashes of arrays and objects, held apart from them
+typedef struct jhashes_t {
+    struct {
+        const jnode_t *node;    // NULL if slot is empty
+        size_t hash;
+    } *slots;
+    size_t capacity;            // Power of 2, or 0 if no slots are allocated
+    size_t count;
+} jhashes_t;
 
-    while ((bal_factor = json_factor(root)) < -1 || bal_factor > 1) {
-        if (bal_factor >= 1)    root = root->lchild;    // Find imbalance
-        else                    root = root->rchild;
-    }
-    while (root->parent)    // Reorder tree with imbalance as root
-        root == root->parent->lchild ? rr_rotate(root) : ll_rotate(root);
-}
+// Version of shared object awaiting reclamation
+typedef struct jretired_t {
+    json_t *json;
+    uint64_t epoch;             // Epoch during which version was replaced
+    struct jretired_t *next;
+} jretired_t;
 
-// Frees entire entry tree from given node
-static void jentry_free(jentry_t *root) {
-    if (root->lchild)   jentry_free(root->lchild);
-    if (root->rchild)   jentry_free(root->rchild);
-    free(root->key);
-    jvalue_free(root->value);
-    free(root);
-}
+// Reader of shared object
+struct jreader_t {
+    _Atomic uint64_t epoch;     // Epoch observed on entry, or 0 if not reading
+    atomic_bool active;         // Reader is owned by a thread
+    struct jshared_t *shared;
+    struct jreader_t *next;
+};
+
+// Shared object
+struct jshared_t {
+    _Atomic(json_t *) current;
+    _Atomic uint64_t epoch;
+    _Atomic(jreader_t *) readers;
+    _Atomic(jretired_t *) retired;
+};
+
+static jentry_t *jentry_new(json_t *json, jentry_t *parent,
+  const char *key, const jvalue_t *restrict value);
+static int (*jvalue_getcmp(char type))(const void *, const void *);
+static int jvalue_find_cmp(const jvalue_t *value1, const jvalue_t *value2, int diff);
+static void jfloat_print(jfloat_t number, FILE *restrict file);
+static void jvalue_print(const jvalue_t *restrict value,
+  FILE *restrict file, size_t indent);
+static bool jobject_print(const json_t *restrict json,
+  FILE *restrict file, size_t indent);
 
 /* Performs LL rotation on a non-NULL, rchild node
  * 
@@ -84,6 +181,7 @@ static void jentry_free(jentry_t *root) {
 static void ll_rotate(jentry_t *node) {
     jentry_t *parent_tmp = node->parent, *child_tmp = node->lchild;
 
+    jstat_add(rotations, 1);
     node->lchild = parent_tmp;
     node->parent = parent_tmp->parent;
     parent_tmp->rchild = child_tmp;
@@ -94,6 +192,8 @@ static void ll_rotate(jentry_t *node) {
         if (parent_tmp == node->parent->lchild) node->parent->lchild = node;
         else                                    node->parent->rchild = node;
     }
+    parent_tmp->height = json_height(parent_tmp);
+    node->height = json_height(node);
 }
 
 /* Performs RR rotation on a non-NULL, lchild node
@@ -107,6 +207,7 @@ static void ll_rotate(jentry_t *node) {
 static void rr_rotate(jentry_t *node) {
     jentry_t *parent_tmp = node->parent, *child_tmp = node->rchild;
 
+    jstat_add(rotations, 1);
     node->rchild = parent_tmp;
     node->parent = parent_tmp->parent;
     parent_tmp->lchild = child_tmp;
@@ -117,38 +218,138 @@ static void rr_rotate(jentry_t *node) {
         if (parent_tmp == node->parent->lchild) node->parent->lchild = node;
         else                                    node->parent->rchild = node;
     }
+    parent_tmp->height = json_height(parent_tmp);
+    node->height = json_height(node);
 }
 
-// Constructs a JSON object at new root according to old root
-static bool json_build(jentry_t *new_root, const jentry_t *old_root) {
-    if (old_root->lchild) {
-        new_root->lchild = jentry_new(new_root,
-          old_root->lchild->key, old_root->lchild->value);
-        if (!new_root->lchild) // jentry_new() fails
-            return false;
-        if (!json_build(new_root->lchild, old_root->lchild)) {
-            jentry_free(new_root->lchild);
-            return false;
-        }     // json_build() fails
-    } else
-        new_root->lchild = NULL;
-    if (old_root->rchild) {
-        new_root->rchild = jentry_new(new_root,
-          old_root->rchild->key, old_root->rchild->value);
-        if (!new_root->rchild)  // jentry_new() fails
-            return false;
-        if (!json_build(new_root->rchild, old_root->rchild)) {
-            if (new_root->lchild)
-                jentry_free(new_root->lchild);
-            jentry_free(new_root->rchild);
+/* Restores heights and balance of every entry from given node up to the root
+ * Returns root of tree */
+static jentry_t *json_balance(jentry_t *node) {
+    jentry_t *root = node;
+
+    while (node) {
+        const long long BAL_FACTOR = json_factor(node);
+
+        if (BAL_FACTOR > 1) {           // Left-heavy
+            if (json_factor(node->lchild) < 0)
+                ll_rotate(node->lchild->rchild);
+            rr_rotate(node->lchild);
+            node = node->parent;
+        } else if (BAL_FACTOR < -1) {   // Right-heavy
+            if (json_factor(node->rchild) > 0)
+                rr_rotate(node->rchild->lchild);
+            ll_rotate(node->rchild);
+            node = node->parent;
+        } else
+            node->height = json_height(node);
+        root = node;
+        node = node->parent;
+    }
+    return root;
+}
+
+/* Frees entire entry tree from given node
+ * Entries are freed in post-order, climbing back through parent pointers. */
+static void jentry_free(jentry_t *root) {
+    jentry_t *node = root, *parent;
+
+    for (;;) {
+        if (node->lchild) {
+            node = node->lchild;
+            continue;
+        }
+        if (node->rchild) {
+            node = node->rchild;
+            continue;
+        }
+        parent = node->parent;      // Leaf, as its children have been freed
+        if (node != root) {
+            if (parent->lchild == node) parent->lchild = NULL;
+            else                        parent->rchild = NULL;
+        }
+        jstat_free(strings, strlen(node->key) + 1);
+        jstat_free(entries, sizeof(jentry_t));
+        free(node->key);
+        jvalue_free(node->value);
+        free(node);
+        if (node == root)
+            return;
+        node = parent;
+    }
+}
+
+// Returns smallest entry of subtree
+static jentry_t *json_smallest(const jentry_t *root) {
+    while (root->lchild)
+        root = root->lchild;
+    return (jentry_t *) root;
+}
+
+// Returns in-order successor of entry, or NULL if it is the largest
+static jentry_t *json_next(const jentry_t *entry) {
+    if (entry->rchild)
+        return json_smallest(entry->rchild);
+    while (entry->parent && entry == entry->parent->rchild)
+        entry = entry->parent;
+    return entry->parent;
+}
+
+// Clears cached hash of array or object, and of every one holding it
+static void jnode_invalidate(jnode_t *node) {
+    while (node && node->hash) {    // Holders of an uncached node are uncached
+        node->hash = 0;
+        node = node->parent;
+    }
+}
+
+// Records array or object holding value
+static void jvalue_attach(jvalue_t *value, jnode_t *parent) {
+    value->parent = parent;
+    if (value->type == J_ARR)       value->value.array->node.parent = parent;
+    else if (value->type == J_OBJ)  value->value.object->node.parent = parent;
+}
+
+/* Constructs a JSON object at new root according to old root
+ * Both trees are walked together in pre-order, climbing back through parent pointers.
+ * On error, the entries copied so far remain linked below the new root */
+static bool json_build(json_t *json, jentry_t *new_root, const jentry_t *old_root) {
+    const jentry_t *old_node = old_root;
+    jentry_t *new_node = new_root, *child;
+
+    new_root->height = old_root->height;
+    new_root->lchild = new_root->rchild = NULL;
+    for (;;) {
+        if (old_node->lchild && !new_node->lchild) {
+            old_node = old_node->lchild;
+            child = new_node->lchild = jentry_new(json, new_node, old_node->key, old_node->value);
+        } else if (old_node->rchild && !new_node->rchild) {
+            old_node = old_node->rchild;
+            child = new_node->rchild = jentry_new(json, new_node, old_node->key, old_node->value);
+        } else if (old_node != old_root) {  // Both children copied
+            old_node = old_node->parent;
+            new_node = new_node->parent;
+            continue;
+        } else
+            return true;
+        if (!child) // jentry_new() fails
             return false;
-        }   // json_build() fails
-    } else
-        new_root->rchild = NULL;
-    return true;
+        child->height = old_node->height;
+        new_node = child;
+    }
+}
+
+// Pushes list of retired versions, from head to tail, onto shared object
+static void jshared_retire(jshared_t *shared, jretired_t *head, jretired_t *tail) {
+    tail->next = atomic_load(&shared->retired);
+    while (!atomic_compare_exchange_weak(&shared->retired, &tail->next, head))
+        ;
 }
 
 // Comparison functions for json_sort()
+static int jvalue_nullcmp(const void *value1, const void *value2) {
+    (void) value1, (void) value2;
+    return 0;
+}
 static int jvalue_boolcmp(const void *value1, const void *value2) {
     return ((jvalue_t *) value1)->value.boolean -
       ((jvalue_t *) value2)->value.boolean;
@@ -157,27 +358,194 @@ static int jvalue_numcmp(const void *value1, const void *value2) {
     const jfloat_t CMP = ((jvalue_t *) value1)->value.number -
       ((jvalue_t *) value2)->value.number;
 
-    return CMP < JFLT_EPSILON ? 0 : jfloat_ceil(CMP);
+    if (CMP > JFLT_EPSILON)         return 1;
+    else if (CMP < -JFLT_EPSILON)   return -1;
+    else                            return 0;
 }
 static int jvalue_strcmp(const void *value1, const void *value2) {
     return strcmp(((jvalue_t *) value1)->value.string,
       ((jvalue_t *) value2)->value.string);
 }
 static int jvalue_arrcmp(const void *value1, const void *value2) {
-    const size_t SIZE1 = ((jvalue_t *) value1)->value.array->size;
-    const size_t SIZE2 = ((jvalue_t *) value2)->value.array->size;
+    const jarray_t *ARRAY1 = ((jvalue_t *) value1)->value.array;
+    const jarray_t *ARRAY2 = ((jvalue_t *) value2)->value.array;
+
+    if (ARRAY1->size > ARRAY2->size)        return 1;
+    else if (ARRAY1->size < ARRAY2->size)   return -1;
+    for (size_t i = 0; i < ARRAY1->size; ++i) {
+        const int CMP = jvalue_find_cmp(ARRAY1->values[i], ARRAY2->values[i],
+          ARRAY1->values[i]->type - ARRAY2->values[i]->type);
 
-    if (SIZE1 > SIZE2)      return 1;
-    else if (SIZE1 < SIZE2) return -1;
-    else                    return 0;
+        if (CMP)
+            return CMP;
+    }
+    return 0;
 }
 static int jvalue_objcmp(const void *value1, const void *value2) {
-    const size_t SIZE1 = json_size(((jvalue_t *) value1)->value.object);
-    const size_t SIZE2 = json_size(((jvalue_t *) value2)->value.object);
+    const json_t *JSON1 = ((jvalue_t *) value1)->value.object;
+    const json_t *JSON2 = ((jvalue_t *) value2)->value.object;
+
+    if (JSON1->size > JSON2->size)          return 1;
+    else if (JSON1->size < JSON2->size)     return -1;
+    if (!JSON1->root)
+        return 0;
+    for (const jentry_t *entry1 = json_smallest(JSON1->root),
+      *entry2 = json_smallest(JSON2->root); entry1;
+      entry1 = json_next(entry1), entry2 = json_next(entry2)) {
+        int cmp = strcmp(entry1->key, entry2->key);
+
+        if (!cmp)
+            cmp = jvalue_find_cmp(entry1->value, entry2->value,
+              entry1->value->type - entry2->value->type);
+        if (cmp)
+            return cmp > 0 ? 1 : -1;
+    }
+    return 0;
+}
+
+// Comparison function for qsort() of array members
+static int jvalue_sortcmp(const void *value1, const void *value2) {
+    const jvalue_t *VALUE1 = *(jvalue_t *const *) value1;
+
+    return jvalue_getcmp(VALUE1->type)(VALUE1, *(jvalue_t *const *) value2);
+}
+
+// Mixes data into FNV-1a hash
+static uint64_t jhash_bytes(uint64_t hash, const void *data, size_t size) {
+    for (size_t i = 0; i < size; ++i)
+        hash = (hash ^ ((const unsigned char *) data)[i]) * 0x100000001b3u;
+    return hash;
+}
+
+// Mixes hash of member into hash of array or object
+#define jhash_mix(hash, member) \
+    (((hash) ^ (member)) * 0x100000001b3u + 0x9e3779b97f4a7c15u)
+
+// Hash of array or object of given node
+#define jhashes_index(hashes, node) \
+    ((size_t) ((uintptr_t) (node) * 0x9e3779b97f4a7c15u >> 32) & ((hashes)->capacity - 1))
+
+/* Returns hash of node recorded in side table, or 0 if there is none
+ * Hashes already cached within the node itself are preferred */
+static size_t jhashes_get(const jhashes_t *hashes, const jnode_t *node) {
+    if (node->hash || !hashes->capacity)
+        return node->hash;
+    for (size_t i = jhashes_index(hashes, node);; i = (i + 1) & (hashes->capacity - 1)) {
+        if (hashes->slots[i].node == node || !hashes->slots[i].node)
+            return hashes->slots[i].hash;
+    }
+}
+
+/* Records hash of node in side table, growing it as required
+ * If memory cannot be allocated, the hash is not recorded. */
+static void jhashes_put(jhashes_t *hashes, const jnode_t *node, size_t hash) {
+    if (hashes->count >= hashes->capacity / 2) {    // Keep table at most half full
+        const jhashes_t OLD = *hashes;
+        const size_t CAPACITY = OLD.capacity ? OLD.capacity * 2 : 64;
+        jhashes_t grown = {calloc(CAPACITY, sizeof(*OLD.slots)), CAPACITY, 0};
+
+        if (!grown.slots)   // calloc() fails
+            return;
+        for (size_t i = 0; i < OLD.capacity; ++i) {
+            if (OLD.slots[i].node)
+                jhashes_put(&grown, OLD.slots[i].node, OLD.slots[i].hash);
+        }
+        free(OLD.slots);
+        *hashes = grown;
+    }
+
+    size_t i = jhashes_index(hashes, node);
+
+    while (hashes->slots[i].node)
+        i = (i + 1) & (hashes->capacity - 1);
+    hashes->slots[i].node = node;
+    hashes->slots[i].hash = hash;
+    ++hashes->count;
+}
+
+/* Returns structural hash of value
+ * Hashes of arrays and objects are cached within them, or if 'side' is not NULL,
+ * recorded there instead, leaving the value unmodified. */
+static uint64_t jvalue_structhash(const jvalue_t *value, jhashes_t *side);
+
+// Caches hash of array or object as described by jvalue_structhash(), returning it
+static size_t jnode_cache(const jnode_t *node, uint64_t hash, jhashes_t *side) {
+    if (!hash)  // 0 marks uncached hash
+        hash = 1;
+    if (side)
+        jhashes_put(side, node, hash);
+    else
+        ((jnode_t *) node)->hash = hash;
+    return hash;
+}
+
+// Returns structural hash of object, caching it
+static uint64_t json_structhash(const json_t *json, jhashes_t *side) {
+    uint64_t hash = side ? jhashes_get(side, &json->node) : json->node.hash;
+
+    if (hash)
+        return hash;
+    hash = jhash_mix(0xcbf29ce484222325u ^ J_OBJ, json->size);
+    if (json->root) {
+        for (const jentry_t *entry = json_smallest(json->root);
+          entry; entry = json_next(entry)) {
+            hash = jhash_mix(hash,
+              jhash_bytes(0xcbf29ce484222325u, entry->key, strlen(entry->key)));
+            hash = jhash_mix(hash, jvalue_structhash(entry->value, side));
+        }
+    }
+    return jnode_cache(&json->node, hash, side);
+}
+
+// Returns structural hash of array, caching it
+static uint64_t jarray_structhash(const jarray_t *array, jhashes_t *side) {
+    uint64_t hash = side ? jhashes_get(side, &array->node) : array->node.hash;
+
+    if (hash)
+        return hash;
+    hash = jhash_mix(0xcbf29ce484222325u ^ J_ARR, array->size);
+    for (size_t i = 0; i < array->size; ++i)
+        hash = jhash_mix(hash, jvalue_structhash(array->values[i], side));
+    return jnode_cache(&array->node, hash, side);
+}
+
+static uint64_t jvalue_structhash(const jvalue_t *value, jhashes_t *side) {
+    const uint64_t SEED = 0xcbf29ce484222325u ^ (uint64_t) value->type;
+    double number;
 
-    if (SIZE1 > SIZE2)      return 1;
-    else if (SIZE1 < SIZE2) return -1;
-    else                    return 0;
+    switch (value->type) {
+    case J_BOOL:
+        return jhash_mix(SEED, value->value.boolean);
+    case J_NUM:
+        number = value->value.number == 0 ? 0 : (double) value->value.number;
+        return jhash_bytes(SEED, &number, sizeof(double));  // -0 == +0
+    case J_STR:
+        return jhash_bytes(SEED, value->value.string, strlen(value->value.string));
+    case J_ARR:
+        return jarray_structhash(value->value.array, side);
+    case J_OBJ:
+        return json_structhash(value->value.object, side);
+    default:
+        return SEED;
+    }
+}
+
+/* Returns true if nodes cannot be equal according to their cached hashes
+ * Uncached hashes are never computed here, as that is a full traversal */
+#define jnode_differ(node1, node2) \
+    ((node1).hash && (node2).hash && (node1).hash != (node2).hash)
+
+static bool json_equal_members(const json_t *json1, const json_t *json2) {
+    if (!json1->root)
+        return true;
+    for (const jentry_t *entry1 = json_smallest(json1->root),
+      *entry2 = json_smallest(json2->root); entry1;
+      entry1 = json_next(entry1), entry2 = json_next(entry2)) {
+        if (strcmp(entry1->key, entry2->key) ||
+          !jvalue_equal(entry1->value, entry2->value))
+            return false;
+    }
+    return true;
 }
 
 /* Returns comparison value (-1/0/1) of value
@@ -188,9 +556,9 @@ static int jvalue_find_cmp(const jvalue_t *value1, const jvalue_t *value2, int d
     return jvalue_getcmp(value1->type)(value1, value2);
 }
 
-/* Generates a new entry
+/* Generates a new entry of given object
  * Returns NULL and sets errno accordingly on error */
-static jentry_t *jentry_new(jentry_t *parent,
+static jentry_t *jentry_new(json_t *json, jentry_t *parent,
   const char *key, const jvalue_t *restrict value) {
     jentry_t *new_entry = malloc(sizeof(jentry_t));
 
@@ -207,81 +575,76 @@ static jentry_t *jentry_new(jentry_t *parent,
         free(new_entry);
         return NULL;
     }
+    jstat_alloc(entries, sizeof(jentry_t));
+    jstat_alloc(strings, strlen(key) + 1);
+    jvalue_attach(new_entry->value, &json->node);
     new_entry->height = 0;
     new_entry->parent = parent;
     new_entry->lchild = new_entry->rchild = NULL;
     return new_entry;
 }
 
-/* Shifts smallest of subtree to top
- * Returns new root */
-static jentry_t *json_smallest(jentry_t *root) {
-    jentry_t *target = root;
+/* Returns location of entry in tree, starting at root, that matches given key
+ * Does not modify the tree, so may be called by concurrent readers */
+static jinfo_t json_seek(const jentry_t *root, const char *key) {
+    jinfo_t info = {0, NULL, NULL};
 
-    while (target->lchild)  // Get smallest
-        target = target->lchild;
-    while (target->parent != root->parent)  // Shift to top
-        rr_rotate(target);
-    return target;
+    while (root) {
+        info.dif = strcmp(key, root->key);
+        jstat_add(comparisons, 1);
+        if (!info.dif) {
+            info.target = (jentry_t *) root;
+            break;
+        }
+        info.parent = (jentry_t *) root;
+        root = info.dif < 0 ? root->lchild : root->rchild;
+    }
+    return info;
 }
 
-/* Shifts largest of subtree to top
- * Returns new root */
-static jentry_t *json_largest(jentry_t *root) {
-    jentry_t *target = root;
+// Compares key of given length against a NUL-terminated key, as strcmp()
+static int jkey_cmp(const char *key, size_t len, const char *other) {
+    const int DIF = strncmp(key, other, len);
 
-    while (target->rchild)  // Get largest
-        target = target->rchild;
-    while (target->parent != root->parent)  // Shift to top
-        ll_rotate(target);
-    return target;
+    return DIF ? DIF : -(other[len] != '\0');
 }
 
-/* Returns entry in tree, starting at root, that matches given key
- * If key is not found, a new entry is added
- * Returns NULL and sets errno accordingly on error */
-static jinfo_t *json_seek(jentry_t *root, const char *key, bool add) {
-    const int DIF = strcmp(key, root->key);
-    jinfo_t *info;
-
-    if (DIF > 0) {
-        if (!root->lchild) {
-            if (add) {
-                info = malloc(sizeof(jinfo_t));
-                if (!info) // malloc() fails
-                    return NULL;
-                info->change = 1;
-                info->target = root->rchild = jentry_new(root, key, NULL);
-            } else
-                info = calloc(1, sizeof(jinfo_t));
-            return info;
-        }
-        info = json_lookup(root->rchild, key);
-        root->height += info->change;
-        return info;
-    } else if (DIF < 0) {
-        if (!root->lchild) {
-            if (add) {
-                info = malloc(sizeof(jinfo_t));
-                if (!info) // malloc() fails
-                    return NULL;
-                info->change = 1;
-                info->target = root->lchild = jentry_new(root, key, NULL);
-            } else
-                info = calloc(1, sizeof(jinfo_t));
-            return info;
+/* Returns first entry whose key is not less than the given key, of given length
+ * If 'past' is set, instead returns first entry whose key is greater than
+ * every key beginning with the given one.
+ * Returns NULL if there is none */
+static jentry_t *json_bound(const jentry_t *root, const char *key, size_t len, bool past) {
+    const jentry_t *bound = NULL;
+
+    while (root) {
+        jstat_add(comparisons, 1);
+        if (past ? strncmp(root->key, key, len) > 0 : jkey_cmp(key, len, root->key) <= 0) {
+            bound = root;
+            root = root->lchild;
+        } else
+            root = root->rchild;
+    }
+    return (jentry_t *) bound;
+}
+
+// Returns location of entry matching key of given length, as json_seek()
+static jinfo_t json_seek_len(const jentry_t *root, const char *key, size_t len) {
+    jinfo_t info = {0, NULL, NULL};
+
+    while (root) {
+        info.dif = jkey_cmp(key, len, root->key);
+        jstat_add(comparisons, 1);
+        if (!info.dif) {
+            info.target = (jentry_t *) root;
+            break;
         }
-        info = json_lookup(root->lchild, key);
-        root->height += info->change;
-        return info;
+        info.parent = (jentry_t *) root;
+        root = info.dif < 0 ? root->lchild : root->rchild;
     }
-    info = calloc(1, sizeof(jinfo_t));
-    if (!info) // calloc() fails
-        return NULL;
-    return root;
+    return info;
 }
 
-//
+// Returns comparison function for values of given type, or NULL if it is invalid
 static int (*jvalue_getcmp(char type))(const void *, const void *) {
     switch (type) {
     case J_BOOL:    return jvalue_boolcmp;
@@ -289,54 +652,1904 @@ static int (*jvalue_getcmp(char type))(const void *, const void *) {
     case J_STR:     return jvalue_strcmp;
     case J_ARR:     return jvalue_arrcmp;
     case J_OBJ:     return jvalue_objcmp;
+    case J_NULL:    return jvalue_nullcmp;
+    default:        return NULL;
     }
 }
 
-void jarray_free(jarray_t *array) {
-    if (array) {
-        for (size_t i = 0; i < array->size; ++i)
-            jvalue_free(array->values + i * sizeof(jvalue_t));
-        free(array);
-    }
+/* Doubles capacity of array
+ * Returns false and sets errno accordingly on error */
+static bool jarray_grow(jarray_t *array) {
+    if (array->capacity > SIZE_MAX / 2 /
+      sizeof(jvalue_t *))   // Array takes up more than SIZE_MAX bytes
+        error(E2BIG, false);
+
+    jvalue_t **new_values = realloc(array->values,
+      array->capacity * 2 * sizeof(jvalue_t *));
+
+    if (!new_values)    // realloc() fails
+        return false;
+    jstat_free(arrays, array->capacity * sizeof(jvalue_t *));  // Counted as free and alloc
+    jstat_alloc(arrays, array->capacity * 2 * sizeof(jvalue_t *));
+    array->values = new_values;
+    array->capacity *= 2;
+    return true;
 }
-void json_free(json_t *json) {
-    if (json) {  // Do not free NULL
+
+/* Inserts copy of value before given index of array
+ * Returns false and sets errno accordingly on error */
+static bool jarray_insert(jarray_t *array, size_t index, const jvalue_t *value) {
+    if (array->size == array->capacity && !jarray_grow(array))
+        return false;   // jarray_grow() fails
+
+    jvalue_t *new_value = jvalue_copy(value);
+
+    if (!new_value) // jvalue_copy() fails
+        return false;
+    jvalue_attach(new_value, &array->node);
+    jnode_invalidate(&array->node);
+    memmove(array->values + index + 1, array->values + index,
+      (array->size - index) * sizeof(jvalue_t *));
+    array->values[index] = new_value;
+    ++array->size;
+    return true;
+}
+
+/* Appends value to array, taking ownership of it
+ * Returns false and sets errno accordingly on error */
+static bool jarray_append(jarray_t *array, jvalue_t *value) {
+    if (array->size == array->capacity && !jarray_grow(array))
+        return false;   // jarray_grow() fails
+    jvalue_attach(value, &array->node);
+    jnode_invalidate(&array->node);
+    array->values[array->size++] = value;
+    return true;
+}
+
+/* Replaces every entry of object with a copy of those of another
+ * Returns false and sets errno accordingly on error */
+static bool json_replace(json_t *json, const json_t *source) {
+    json_t *new_json = json_copy(source);
+
+    if (!new_json)  // json_copy() fails
+        return false;
+    jnode_invalidate(&json->node);
+    if (json->root)
         jentry_free(json->root);
-        free(json);
+    json->root = new_json->root;
+    json->size = new_json->size;
+    if (json->root) {
+        for (jentry_t *entry = json_smallest(json->root); entry; entry = json_next(entry))
+            jvalue_attach(entry->value, &json->node);
     }
+    jstat_free(objects, sizeof(json_t));
+    free(new_json);
+    return true;
 }
-void jvalue_free(jvalue_t *value) {
-    if (value) {
-        switch (value->type) {
-        case J_STR: free(value->value.string);          break;
-        case J_ARR: jarray_free(value->value.array);    break;
-        case J_OBJ: json_free(value->value.object);
+
+// JSON Pointer under construction
+typedef struct jpath_t {
+    char *data;
+    size_t length, capacity;
+} jpath_t;
+
+// Location referenced by a JSON Pointer
+typedef struct jlocation_t {
+    json_t *object;     // Object holding target, if any
+    jarray_t *array;    // Array holding target, if any
+    char *key;          // Final reference token; owned by location
+    size_t index;       // Index of target within array
+} jlocation_t;
+
+/* Appends reference token to pointer, escaping '~' and '/'
+ * Returns false and sets errno accordingly on error */
+static bool jpath_push(jpath_t *path, const char *token) {
+    const size_t LEN = strlen(token);
+
+    if (path->length + 2 * LEN + 2 > path->capacity) {
+        const size_t CAPACITY = 2 * (path->length + 2 * LEN + 2);
+        char *new_data = realloc(path->data, CAPACITY);
+
+        if (!new_data)  // realloc() fails
+            return false;
+        path->data = new_data;
+        path->capacity = CAPACITY;
+    }
+    path->data[path->length++] = '/';
+    for (size_t i = 0; i < LEN; ++i) {
+        if (token[i] == '~' || token[i] == '/') {
+            path->data[path->length++] = '~';
+            path->data[path->length++] = token[i] == '~' ? '0' : '1';
+        } else
+            path->data[path->length++] = token[i];
+    }
+    path->data[path->length] = '\0';
+    return true;
+}
+
+// Appends array index to pointer
+static bool jpath_push_index(jpath_t *path, size_t index) {
+    char token[24];
+
+    snprintf(token, sizeof token, "%zu", index);
+    return jpath_push(path, token);
+}
+
+// Restores pointer to given length
+#define jpath_pop(path, len)    ((path)->data[(path)->length = (len)] = '\0')
+
+/* Appends single operation to patch
+ * Returns false and sets errno accordingly on error */
+static bool jdiff_push(jarray_t *patch,
+  const char *op, const jpath_t *path, const jvalue_t *value) {
+    const jvalue_t OP = {J_STR, {.string = (char *) op}, NULL};
+    const jvalue_t PATH = {J_STR, {.string = path->data}, NULL};
+    json_t *new_op = json_new();
+    jvalue_t *new_value;
+
+    if (!new_op)    // json_new() fails
+        return false;
+    if (!json_add(new_op, "op", &OP) || !json_add(new_op, "path", &PATH) ||
+      (value && !json_add(new_op, "value", value)))
+        goto failure;   // json_add() fails
+    new_value = malloc(sizeof(jvalue_t));
+    if (!new_value) // malloc() fails
+        goto failure;
+    jstat_alloc(values, sizeof(jvalue_t));
+    new_value->type = J_OBJ;
+    new_value->value.object = new_op;
+    new_value->parent = NULL;
+    if (!jarray_append(patch, new_value)) {
+        jvalue_free(new_value);
+        return false;
+    }   // jarray_append() fails
+    return true;
+failure:
+    json_free(new_op);
+    return false;
+}
+
+static bool jdiff_object(jarray_t *patch, jpath_t *path,
+  const jhashes_t *hashes, const json_t *json1, const json_t *json2);
+static bool jdiff_array(jarray_t *patch, jpath_t *path,
+  const jhashes_t *hashes, const jarray_t *array1, const jarray_t *array2);
+
+// Returns node of array or object, or NULL if value is neither
+#define jvalue_node(jvalue)                                         \
+    ((jvalue)->type == J_ARR ? &(jvalue)->value.array->node :       \
+    (jvalue)->type == J_OBJ ? &(jvalue)->value.object->node : NULL)
+
+/* Returns true if values are equal
+ * Unequal arrays and objects are rejected early by their hashes in side table */
+static bool jdiff_equal(const jhashes_t *hashes,
+  const jvalue_t *value1, const jvalue_t *value2) {
+    const jnode_t *const NODE1 = jvalue_node(value1), *const NODE2 = jvalue_node(value2);
+
+    if (NODE1 && NODE2 && value1->type == value2->type) {
+        const size_t HASH1 = jhashes_get(hashes, NODE1), HASH2 = jhashes_get(hashes, NODE2);
+
+        if (HASH1 && HASH2 && HASH1 != HASH2)
+            return false;
+    }
+    return jvalue_equal(value1, value2);
+}
+
+// Appends operations transforming one value into another
+static bool jdiff_value(jarray_t *patch, jpath_t *path,
+  const jhashes_t *hashes, const jvalue_t *value1, const jvalue_t *value2) {
+    if (jdiff_equal(hashes, value1, value2))
+        return true;
+    if (value1->type == J_OBJ && value2->type == J_OBJ)
+        return jdiff_object(patch, path, hashes, value1->value.object, value2->value.object);
+    if (value1->type == J_ARR && value2->type == J_ARR)
+        return jdiff_array(patch, path, hashes, value1->value.array, value2->value.array);
+    return jdiff_push(patch, "replace", path, value2);
+}
+
+// Appends operations transforming one object into another, merging both in key order
+static bool jdiff_object(jarray_t *patch, jpath_t *path,
+  const jhashes_t *hashes, const json_t *json1, const json_t *json2) {
+    const size_t LEN = path->length;
+    const jentry_t *entry1 = json1->root ? json_smallest(json1->root) : NULL;
+    const jentry_t *entry2 = json2->root ? json_smallest(json2->root) : NULL;
+    bool success = true;
+
+    while (success && (entry1 || entry2)) {
+        const int DIF = !entry1 ? 1 : !entry2 ? -1 : strcmp(entry1->key, entry2->key);
+
+        if (!jpath_push(path, DIF > 0 ? entry2->key : entry1->key))
+            return false;   // jpath_push() fails
+        if (DIF < 0) {          // Only in first
+            success = jdiff_push(patch, "remove", path, NULL);
+            entry1 = json_next(entry1);
+        } else if (DIF > 0) {   // Only in second
+            success = jdiff_push(patch, "add", path, entry2->value);
+            entry2 = json_next(entry2);
+        } else {
+            success = jdiff_value(patch, path, hashes, entry1->value, entry2->value);
+            entry1 = json_next(entry1);
+            entry2 = json_next(entry2);
+        }
+        jpath_pop(path, LEN);
+    }
+    return success;
+}
+
+/* Appends operations transforming one array into another
+ * After trimming the common prefix and suffix, the remaining members are
+ * aligned by their longest common subsequence if there are no more than
+ * JDIFF_LCSMAX pairs of them; otherwise, they are compared by position. */
+static bool jdiff_array(jarray_t *patch, jpath_t *path,
+  const jhashes_t *hashes, const jarray_t *array1, const jarray_t *array2) {
+    const size_t LEN = path->length;
+    const size_t MIN = array1->size < array2->size ? array1->size : array2->size;
+    size_t prefix = 0, suffix = 0, n, m, i = 0, j = 0, index;
+    bool success = true;
+
+    while (prefix < MIN &&
+      jdiff_equal(hashes, array1->values[prefix], array2->values[prefix]))
+        ++prefix;
+    while (suffix < MIN - prefix &&
+      jdiff_equal(hashes, array1->values[array1->size - suffix - 1],
+      array2->values[array2->size - suffix - 1]))
+        ++suffix;
+    n = array1->size - prefix - suffix;
+    m = array2->size - prefix - suffix;
+    index = prefix;
+
+    jvalue_t *const *values1 = array1->values + prefix;
+    jvalue_t *const *values2 = array2->values + prefix;
+    size_t *lcs = NULL;
+
+    if (n && m && (n + 1) <= JDIFF_LCSMAX / (m + 1)) {
+        lcs = malloc((n + 1) * (m + 1) * sizeof(size_t));
+        if (!lcs)   // malloc() fails
+            return false;
+    }
+    if (lcs) {  // Length of LCS of each pair of suffixes
+#define lcs_at(row, col)    lcs[(row) * (m + 1) + (col)]
+        for (size_t row = n + 1; row--;) {
+            for (size_t col = m + 1; col--;) {
+                if (row == n || col == m)
+                    lcs_at(row, col) = 0;
+                else if (jdiff_equal(hashes, values1[row], values2[col]))
+                    lcs_at(row, col) = lcs_at(row + 1, col + 1) + 1;
+                else
+                    lcs_at(row, col) = lcs_at(row + 1, col) > lcs_at(row, col + 1) ?
+                      lcs_at(row + 1, col) : lcs_at(row, col + 1);
+            }
+        }
+    }
+    while (success && (i < n || j < m)) {
+        if (!jpath_push_index(path, index)) {
+            success = false;
+            break;
+        }   // jpath_push_index() fails
+        if (i < n && j < m && (!lcs ||
+          lcs_at(i + 1, j + 1) == lcs_at(i, j) - jdiff_equal(hashes, values1[i], values2[j]))) {
+            success = jdiff_value(patch, path, hashes, values1[i++], values2[j++]);
+            ++index;    // Keep or replace in place
+        } else if (j == m || (i < n && lcs_at(i + 1, j) >= lcs_at(i, j + 1))) {
+            success = jdiff_push(patch, "remove", path, NULL);
+            ++i;
+        } else {
+            success = jdiff_push(patch, "add", path, values2[j++]);
+            ++index;
+        }
+        jpath_pop(path, LEN);
+    }
+#undef lcs_at
+    free(lcs);
+    return success;
+}
+
+/* Resolves JSON Pointer to the location of its target within object
+ * The target itself need not exist. An empty pointer refers to the object.
+ * Returns false and sets errno accordingly on error */
+static bool jpointer_resolve(json_t *json, const char *pointer, jlocation_t *location) {
+    const char *token = pointer;
+    jvalue_t *child;
+    char *end;
+
+    location->object = json;
+    location->array = NULL;
+    location->key = NULL;
+    location->index = 0;
+    if (!*pointer) {    // Refers to whole object
+        location->object = NULL;
+        return true;
+    }
+    if (*pointer != '/')
+        error(EINVAL, false);
+    location->key = malloc(strlen(pointer));
+    if (!location->key) // malloc() fails
+        return false;
+    for (;;) {
+        size_t len = 0;
+
+        for (++token; *token && *token != '/'; ++token) {   // Unescape token
+            if (*token == '~') {
+                if (token[1] != '0' && token[1] != '1')
+                    goto invalid;
+                location->key[len++] = *++token == '0' ? '~' : '/';
+            } else
+                location->key[len++] = *token;
+        }
+        location->key[len] = '\0';
+        if (!*token)
+            token = NULL;
+        if (location->array) {
+            if (!strcmp(location->key, "-"))
+                location->index = location->array->size;
+            else {
+                if (!len || (location->key[0] == '0' && len > 1) ||
+                  location->key[0] < '0' || location->key[0] > '9')
+                    goto invalid;
+                errno = 0;
+                location->index = strtoull(location->key, &end, 10);
+                if (*end || errno)
+                    goto invalid;
+            }
+        }
+        if (!token)
+            return true;
+        if (location->object)
+            child = json_find(location->object, location->key);
+        else
+            child = location->index < location->array->size ?
+              location->array->values[location->index] : NULL;
+        if (!child || (child->type != J_OBJ && child->type != J_ARR)) {
+            free(location->key);
+            error(ENOENT, false);
+        }   // Intermediate target does not exist
+        location->object = child->type == J_OBJ ? child->value.object : NULL;
+        location->array = child->type == J_ARR ? child->value.array : NULL;
+    }
+invalid:
+    free(location->key);
+    error(EINVAL, false);
+}
+
+// Returns target of location, or NULL if it does not exist
+static jvalue_t *jlocation_get(const jlocation_t *location) {
+    jvalue_t *target = NULL;
+
+    if (location->object)
+        target = json_find(location->object, location->key);
+    else if (location->array && location->index < location->array->size)
+        target = location->array->values[location->index];
+    if (!target)
+        errno = ENOENT;
+    return target;
+}
+
+/* Inserts copy of value at location, replacing any existing member of an object
+ * Returns false and sets errno accordingly on error */
+static bool jlocation_add(json_t *json,
+  const jlocation_t *location, const jvalue_t *value) {
+    if (location->object)
+        return json_add(location->object, location->key, value);
+    if (location->array) {
+        if (location->index > location->array->size)
+            error(ENOENT, false);
+        return jarray_insert(location->array, location->index, value);
+    }
+    if (value->type != J_OBJ)   // Whole object must remain an object
+        error(EINVAL, false);
+    return json_replace(json, value->value.object);
+}
+
+/* Removes target of location
+ * Returns false and sets errno accordingly on error */
+static bool jlocation_remove(const jlocation_t *location) {
+    if (location->object)
+        return json_remove(location->object, location->key);
+    if (location->array)
+        return jarray_remove(location->array, location->index);
+    error(EINVAL, false);   // Cannot remove whole object
+}
+
+/* Applies single operation of patch to object
+ * Returns false and sets errno accordingly on error */
+static bool jpatch_apply_op(json_t *json, const jvalue_t *op) {
+    if (op->type != J_OBJ)
+        error(EINVAL, false);
+
+    const jvalue_t *NAME = json_find(op->value.object, "op");
+    const jvalue_t *PATH = json_find(op->value.object, "path");
+    const jvalue_t *FROM = json_find(op->value.object, "from");
+    const jvalue_t *VALUE = json_find(op->value.object, "value");
+    const jvalue_t WHOLE = {J_OBJ, {.object = json}, NULL};
+    jlocation_t location, from;
+    jvalue_t *target, *moved;
+    bool success;
+
+    if (!NAME || NAME->type != J_STR || !PATH || PATH->type != J_STR ||
+      (FROM && FROM->type != J_STR))
+        error(EINVAL, false);
+    if (!strcmp(NAME->value.string, "move") || !strcmp(NAME->value.string, "copy")) {
+        const size_t LEN = FROM ? strlen(FROM->value.string) : 0;
+
+        if (!FROM)
+            error(EINVAL, false);
+        if (!strcmp(NAME->value.string, "move")) {
+            if (!strcmp(FROM->value.string, PATH->value.string))
+                return true;
+            if (!strncmp(FROM->value.string, PATH->value.string, LEN) &&
+              PATH->value.string[LEN] == '/')   // Cannot move into own member
+                error(EINVAL, false);
+        }
+        if (!jpointer_resolve(json, FROM->value.string, &from))
+            return false;
+        target = from.object || from.array ? jlocation_get(&from) : (jvalue_t *) &WHOLE;
+        if (!target) {
+            free(from.key);
+            return false;
+        }   // jlocation_get() fails
+        if (!strcmp(NAME->value.string, "copy")) {
+            free(from.key);
+            if (!jpointer_resolve(json, PATH->value.string, &location))
+                return false;
+            success = jlocation_add(json, &location, target);
+            free(location.key);
+            return success;
+        }
+        moved = jvalue_copy(target);
+        if (!moved || !jlocation_remove(&from)) {
+            if (moved)
+                jvalue_free(moved);
+            free(from.key);
+            return false;
+        }   // jvalue_copy() fails || jlocation_remove() fails
+        free(from.key);
+        success = jpointer_resolve(json, PATH->value.string, &location);
+        if (success) {
+            success = jlocation_add(json, &location, moved);
+            free(location.key);
+        }
+        jvalue_free(moved);
+        return success;
+    }
+    if (!jpointer_resolve(json, PATH->value.string, &location))
+        return false;
+    if (!strcmp(NAME->value.string, "add"))
+        success = VALUE ? jlocation_add(json, &location, VALUE) : (errno = EINVAL, false);
+    else if (!strcmp(NAME->value.string, "remove"))
+        success = jlocation_remove(&location);
+    else if (!strcmp(NAME->value.string, "replace")) {
+        target = location.object || location.array ? jlocation_get(&location) : NULL;
+        if (!VALUE)
+            success = (errno = EINVAL, false);
+        else if (!location.object && !location.array)
+            success = jlocation_add(json, &location, VALUE);
+        else if (!target)
+            success = false;
+        else if (location.object)
+            success = json_add(location.object, location.key, VALUE);
+        else
+            success = jvalue_modify(target, VALUE);
+    } else if (!strcmp(NAME->value.string, "test")) {
+        target = location.object || location.array ?
+          jlocation_get(&location) : (jvalue_t *) &WHOLE;
+        if (!VALUE)
+            success = (errno = EINVAL, false);
+        else if (!target)
+            success = false;
+        else if (!(success = jvalue_equal(target, VALUE)))
+            errno = ECANCELED;
+    } else
+        success = (errno = EINVAL, false);
+    free(location.key);
+    return success;
+}
+
+static bool json_merge_entries(json_t *dst, json_t *src, bool move);
+
+/* Returns new object value merged from an empty object according to src,
+ * which, as RFC 7386 specifies, is src without members that are null
+ * Returns NULL and sets errno accordingly on error */
+static jvalue_t *jvalue_merged(json_t *src, bool move) {
+    jvalue_t *new_value = malloc(sizeof(jvalue_t));
+
+    if (!new_value) // malloc() fails
+        return NULL;
+    new_value->type = J_OBJ;
+    new_value->parent = NULL;
+    new_value->value.object = json_new();
+    if (!new_value->value.object) {
+        free(new_value);
+        return NULL;
+    }   // json_new() fails
+    jstat_alloc(values, sizeof(jvalue_t));
+    if (!json_merge_entries(new_value->value.object, src, move)) {
+        jvalue_free(new_value);
+        return NULL;
+    }   // json_merge_entries() fails
+    return new_value;
+}
+
+// Links entries, sorted by key, into balanced tree, returning its root
+static jentry_t *json_link(jentry_t **entries, size_t count, jentry_t *parent) {
+    if (!count)
+        return NULL;
+
+    const size_t MID = count / 2;
+    jentry_t *root = entries[MID];
+
+    root->parent = parent;
+    root->lchild = json_link(entries, MID, root);
+    root->rchild = json_link(entries + MID + 1, count - MID - 1, root);
+    root->height = json_height(root);
+    return root;
+}
+
+// Frees single entry detached from its tree
+static void jentry_free_one(jentry_t *entry) {
+    jstat_free(strings, strlen(entry->key) + 1);
+    jstat_free(entries, sizeof(jentry_t));
+    free(entry->key);
+    jvalue_free(entry->value);
+    free(entry);
+}
+
+/* Merges src into dst as RFC 7386 specifies, walking both in key order
+ * If 'move' is true, values are moved out of src, which is left empty.
+ * On error, dst remains valid with a part of src merged into it.
+ * Returns false and sets errno accordingly on error */
+static bool json_merge_entries(json_t *dst, json_t *src, bool move) {
+    const size_t SIZE1 = dst->size, SIZE2 = src->size;
+    jentry_t **entries = malloc(2 * (SIZE1 + SIZE2 + 1) * sizeof(jentry_t *));
+    jentry_t **entries1, **entries2, **merged;
+    const jvalue_t NULL_VALUE = {J_NULL, {.boolean = false}, NULL};
+    size_t i = 0, j = 0, count = 0;
+    bool success = true;
+
+    if (!entries)   // malloc() fails
+        return false;
+    merged = entries;
+    entries1 = merged + SIZE1 + SIZE2;
+    entries2 = entries1 + SIZE1;
+    if (dst->root) {
+        for (jentry_t *entry = json_smallest(dst->root); entry; entry = json_next(entry))
+            entries1[i++] = entry;
+    }
+    if (src->root) {
+        for (jentry_t *entry = json_smallest(src->root); entry; entry = json_next(entry))
+            entries2[j++] = entry;
+    }
+    jnode_invalidate(&dst->node);
+    i = j = 0;
+    while (success && (i < SIZE1 || j < SIZE2)) {
+        const int DIF = i == SIZE1 ? 1 : j == SIZE2 ? -1 :
+          strcmp(entries1[i]->key, entries2[j]->key);
+        jentry_t *target = DIF <= 0 ? entries1[i] : NULL;
+        jvalue_t *patch = DIF >= 0 ? entries2[j]->value : NULL, *new_value = NULL;
+
+        if (DIF <= 0)   ++i;
+        if (DIF >= 0)   ++j;
+        if (!patch) {                   // Only in dst
+            merged[count++] = target;
+            continue;
+        }
+        if (patch->type == J_NULL) {    // Remove from dst
+            if (target)
+                jentry_free_one(target);
+            continue;
+        }
+        if (patch->type == J_OBJ && target && target->value->type == J_OBJ) {
+            success = json_merge_entries(target->value->value.object,
+              patch->value.object, move);
+            merged[count++] = target;
+            continue;
+        }
+        if (patch->type == J_OBJ)
+            new_value = jvalue_merged(patch->value.object, move);
+        else if (move && !target) {     // Reuse entry of src
+            merged[count++] = entries2[j - 1];
+            entries2[j - 1] = NULL;
+            continue;
+        } else if (move) {      // Swap values, so that src frees that of dst
+            entries2[j - 1]->value = target->value;
+            target->value = patch;
+            merged[count++] = target;
+            continue;
+        } else
+            new_value = jvalue_copy(patch);
+        if (!new_value) {
+            success = false;
+            if (target)
+                merged[count++] = target;
+            break;
+        }   // jvalue_merged() fails || jvalue_copy() fails
+        if (!target) {
+            target = jentry_new(dst, NULL, entries2[j - 1]->key, &NULL_VALUE);
+            if (!target) {
+                jvalue_free(new_value);
+                success = false;
+                break;
+            }   // jentry_new() fails
+        }
+        jvalue_free(target->value);
+        target->value = new_value;
+        merged[count++] = target;
+    }
+    while (i < SIZE1)   // Keep rest of dst on error
+        merged[count++] = entries1[i++];
+    for (size_t k = 0; k < count; ++k)
+        jvalue_attach(merged[k]->value, &dst->node);
+    dst->root = json_link(merged, count, NULL);
+    dst->size = count;
+    if (move) {
+        for (j = 0; j < SIZE2; ++j) {
+            if (entries2[j])
+                jentry_free_one(entries2[j]);
+        }
+        jnode_invalidate(&src->node);
+        src->root = NULL;
+        src->size = 0;
+    }
+    free(entries);
+    return success;
+}
+
+// Input read by parser and schema decoder
+typedef struct jscanner_t {
+    const char *pos, *end;
+} jscanner_t;
+
+// Fails scanning of malformed input
+#define jscan_fail(ret)     error(EILSEQ, ret)
+
+// Returns slot of schema table holding key of given hash
+#define jschema_slot(schema, hash)                                  \
+    (((hash) + (schema)->displace[jschema_bucket(schema, hash)]     \
+      * ((hash) >> 24 | 1)) & ((schema)->slots - 1))
+
+// Returns bucket of schema holding key of given hash
+#define jschema_bucket(schema, hash)    (((hash) >> 40) % (schema)->buckets)
+
+// Returns member of struct described by field
+#define jfield_member(object, field)    ((char *) (object) + (field)->offset)
+
+// Flags containers of validator nested within one another, set for objects
+#define jdepth_set(stack, depth, object) \
+    ((stack)[(depth) / 64] = ((stack)[(depth) / 64] & ~((uint64_t) 1 << (depth) % 64)) \
+      | (uint64_t) (object) << (depth) % 64)
+#define jdepth_get(stack, depth)    ((stack)[(depth) / 64] >> (depth) % 64 & 1)
+
+// Returns true if byte may appear within a string as is, and is ASCII
+#define jstring_plain(c)    ((c) >= 0x20 && (c) < 0x80 && (c) != '"' && (c) != '\\')
+
+// Tries to find a perfect hash table for a schema under this many seeds
+#define JSCHEMA_SEEDS   16
+
+// Structs, counting nested ones, whose decoded fields are tracked without allocating
+#define JSCHEMA_SEENBUF 16
+
+static jvalue_t *jparse_value(jscanner_t *scanner, size_t depth);
+static bool jschema_decode_object(jschema_t *schema,
+  jscanner_t *scanner, void *object, size_t depth, uint64_t *seen);
+
+// Frees string allocated by this library
+static void jstring_free(char *string) {
+    jstat_free(strings, strlen(string) + 1);
+    free(string);
+}
+
+/* Skips whitespace
+ * Returns next character, or '\0' at end of input */
+static char jscan_space(jscanner_t *scanner) {
+    while (scanner->pos < scanner->end) {
+        switch (*scanner->pos) {
+        case ' ': case '\t': case '\n': case '\r':
+            ++scanner->pos;
+            break;
+        default:
+            return *scanner->pos;
+        }
+    }
+    return '\0';
+}
+
+// Consumes character following whitespace, failing if another is found
+static bool jscan_char(jscanner_t *scanner, char c) {
+    if (jscan_space(scanner) != c)
+        jscan_fail(false);
+    ++scanner->pos;
+    return true;
+}
+
+/* Consumes literal, failing if input does not hold it
+ * On error, leaves scanner at the first byte that differs */
+static bool jscan_literal(jscanner_t *scanner, const char *literal) {
+    while (*literal) {
+        if (scanner->pos == scanner->end || *scanner->pos != *literal)
+            jscan_fail(false);
+        ++scanner->pos;
+        ++literal;
+    }
+    return true;
+}
+
+// Returns first character following a run of digits
+static const char *jscan_digits(const char *pos, const char *end) {
+    while (pos < end && *pos >= '0' && *pos <= '9')
+        ++pos;
+    return pos;
+}
+
+/* Scans number, as described by RFC 8259, returning its length
+ * 'integral' is set if the number has neither fraction nor exponent
+ * Returns 0 and sets errno to EILSEQ if input does not hold a number,
+ * leaving scanner at the offending byte */
+static size_t jscan_number_span(jscanner_t *scanner, bool *integral) {
+    const char *const BEGIN = scanner->pos, *const END = scanner->end, *pos = BEGIN, *digits;
+
+    *integral = true;
+    if (pos < END && *pos == '-')
+        ++pos;
+    if (pos < END && *pos == '0')
+        ++pos;
+    else if (pos < END && *pos >= '1' && *pos <= '9')
+        pos = jscan_digits(pos + 1, END);
+    else
+        goto invalid;
+    if (pos < END && *pos == '.') {
+        *integral = false;
+        digits = ++pos;
+        if ((pos = jscan_digits(pos, END)) == digits)
+            goto invalid;
+    }
+    if (pos < END && (*pos == 'e' || *pos == 'E')) {
+        *integral = false;
+        if (++pos < END && (*pos == '+' || *pos == '-'))
+            ++pos;
+        digits = pos;
+        if ((pos = jscan_digits(pos, END)) == digits)
+            goto invalid;
+    }
+    scanner->pos = pos;
+    return pos - BEGIN;
+invalid:
+    scanner->pos = pos;
+    jscan_fail(0);
+}
+
+/* Scans number, converting it to jfloat_t
+ * Returns false and sets errno accordingly on error,
+ * or to ERANGE if it is too large to be represented */
+static bool jscan_number(jscanner_t *scanner, jfloat_t *number) {
+    jscan_space(scanner);
+
+    const char *const BEGIN = scanner->pos;
+    bool integral;
+    const size_t LEN = jscan_number_span(scanner, &integral);
+    char buffer[JSCAN_NUMBUF], *text = buffer;
+    jfloat_t value;
+
+    if (!LEN)   // jscan_number_span() fails
+        return false;
+    if (LEN >= JSCAN_NUMBUF && !(text = malloc(LEN + 1)))
+        return false;   // malloc() fails
+    memcpy(text, BEGIN, LEN);   // strtod() requires terminated string
+    text[LEN] = '\0';
+    value = jfloat_strto(text, NULL);
+    if (text != buffer)
+        free(text);
+    if (isinf(value))
+        error(ERANGE, false);
+    *number = value;
+    return true;
+}
+
+/* Scans number, converting it to long long
+ * Returns false and sets errno accordingly on error,
+ * or to ERANGE if it is not a whole number within range */
+static bool jscan_integer(jscanner_t *scanner, long long *integer) {
+    jscan_space(scanner);
+
+    const char *const BEGIN = scanner->pos;
+    bool integral;
+    const size_t LEN = jscan_number_span(scanner, &integral);
+    char buffer[JSCAN_NUMBUF];
+
+    if (!LEN)   // jscan_number_span() fails
+        return false;
+    if (!integral) {        // Whole numbers may still be written as 1e3 or 1.0
+        jfloat_t number;
+
+        scanner->pos = BEGIN;
+        if (!jscan_number(scanner, &number))
+            return false;   // jscan_number() fails
+        if (number != jfloat_ceil(number) || number < -0x1p63 || number >= 0x1p63)
+            error(ERANGE, false);
+        *integer = (long long) number;
+        return true;
+    }
+    if (LEN >= JSCAN_NUMBUF)    // Too many digits for any long long
+        error(ERANGE, false);
+    memcpy(buffer, BEGIN, LEN);
+    buffer[LEN] = '\0';
+    errno = 0;
+
+    const long long VALUE = strtoll(buffer, NULL, 10);
+
+    if (errno == ERANGE)    // Clamped to LLONG_MIN or LLONG_MAX
+        return false;
+    *integer = VALUE;
+    return true;
+}
+
+/* Returns number of leading bytes that may appear within a string as is
+ * Stops at a quote, backslash or control character, and if 'ascii' is set,
+ * at any byte of a multi-byte sequence, which must then be validated.
+ * Scans 16 bytes at a time with SSE2, or otherwise checks 8 at a time within a word. */
+static size_t jstring_span(const char *string, const char *end, bool ascii) {
+    const char *pos = string;
+#ifdef JSON_SSE2
+    const __m128i QUOTE = _mm_set1_epi8('"'), BACKSLASH = _mm_set1_epi8('\\'),
+      SPACE = _mm_set1_epi8(' '), CONTROL = _mm_set1_epi8(0x1F);
+
+    for (; end - pos >= 16; pos += 16) {
+        const __m128i CHUNK = _mm_loadu_si128((const __m128i *) pos);
+        const __m128i BELOW = ascii
+          ? _mm_cmplt_epi8(CHUNK, SPACE)    // Signed, so also matches bytes from 0x80
+          : _mm_cmpeq_epi8(_mm_min_epu8(CHUNK, CONTROL), CHUNK);
+        const int MASK = _mm_movemask_epi8(_mm_or_si128(BELOW,
+          _mm_or_si128(_mm_cmpeq_epi8(CHUNK, QUOTE), _mm_cmpeq_epi8(CHUNK, BACKSLASH))));
+
+        if (MASK)
+            return pos - string + jbit_ctz(MASK);
+    }
+#else
+    const uint64_t ONES = 0x0101010101010101u, HIGHS = 0x8080808080808080u;
+
+    for (uint64_t word, quote, backslash; end - pos >= 8; pos += 8) {
+        memcpy(&word, pos, 8);
+        quote = word ^ ONES * '"';
+        backslash = word ^ ONES * '\\';
+        if (((ascii ? word : 0) | ((quote - ONES) & ~quote) |
+          ((backslash - ONES) & ~backslash) | ((word - ONES * 0x20) & ~word)) & HIGHS)
+            break;  // Word holds a byte that is not plain, located below
+    }
+#endif
+    while (pos < end && (ascii ? jstring_plain((unsigned char) *pos)
+      : (unsigned char) *pos >= 0x20 && *pos != '"' && *pos != '\\'))
+        ++pos;
+    return pos - string;
+}
+
+/* Returns length of UTF-8 sequence beginning a string, or 0 if it is invalid
+ * Overlong encodings, surrogates and code points past U+10FFFF are invalid. */
+static size_t jutf8_length(const char *string, const char *end) {
+    const unsigned char *const BYTES = (const unsigned char *) string;
+    const size_t AVAILABLE = end - string;
+    unsigned char low = 0x80, high = 0xBF;  // Range of second byte
+    size_t len;
+
+    if (BYTES[0] < 0x80)
+        return 1;
+    if (BYTES[0] < 0xC2)        // Continuation byte || overlong 2-byte sequence
+        return 0;
+    if (BYTES[0] < 0xE0)
+        len = 2;
+    else if (BYTES[0] < 0xF0) {
+        len = 3;
+        if (BYTES[0] == 0xE0)       low = 0xA0;     // Overlong
+        else if (BYTES[0] == 0xED)  high = 0x9F;    // Surrogate
+    } else if (BYTES[0] < 0xF5) {
+        len = 4;
+        if (BYTES[0] == 0xF0)       low = 0x90;     // Overlong
+        else if (BYTES[0] == 0xF4)  high = 0x8F;    // Past U+10FFFF
+    } else
+        return 0;
+    if (AVAILABLE < len || BYTES[1] < low || BYTES[1] > high)
+        return 0;
+    for (size_t i = 2; i < len; ++i) {
+        if ((BYTES[i] & 0xC0) != 0x80)
+            return 0;
+    }
+    return len;
+}
+
+/* Scans string, returning length of its contents, which follow the opening quote
+ * Contents must be valid UTF-8. ASCII runs are skipped by jstring_span().
+ * 'escaped' is set if the contents hold escape sequences, which are not validated
+ * Returns SIZE_MAX and sets errno to EILSEQ if input does not hold a string */
+static size_t jscan_string_span(jscanner_t *scanner, const char **contents, bool *escaped) {
+    if (!jscan_char(scanner, '"'))
+        return SIZE_MAX;
+
+    const char *pos = scanner->pos, *const END = scanner->end;
+    size_t len;
+
+    *contents = pos;
+    *escaped = false;
+    for (;;) {
+        pos += jstring_span(pos, END, true);
+        if (pos == END)
+            break;
+        if (*pos == '"') {
+            scanner->pos = pos + 1;
+            return pos - *contents;
+        }
+        if (*pos == '\\') {
+            *escaped = true;
+            len = 2;
+            if (END - pos < 2)
+                break;
+        } else if ((unsigned char) *pos < 0x20)   // Control characters must be escaped
+            break;
+        else if (!(len = jutf8_length(pos, END)))
+            break;
+        pos += len;
+    }
+    jscan_fail(SIZE_MAX);
+}
+
+// Returns value of 4 hexadecimal digits, or -1 if any is invalid
+static long jhex_decode(const char *digits) {
+    long value = 0;
+
+    for (int i = 0; i < 4; ++i) {
+        const char C = digits[i], LOWER = C | 0x20;
+
+        value <<= 4;
+        if (C >= '0' && C <= '9')
+            value |= C - '0';
+        else if (LOWER >= 'a' && LOWER <= 'f')
+            value |= LOWER - 'a' + 10;
+        else
+            return -1;
+    }
+    return value;
+}
+
+// Writes code point as UTF-8, returning number of bytes written
+static size_t jutf8_encode(char *dst, unsigned long point) {
+    if (point < 0x80) {
+        dst[0] = point;
+        return 1;
+    }
+    if (point < 0x800) {
+        dst[0] = 0xC0 | point >> 6;
+        dst[1] = 0x80 | (point & 0x3F);
+        return 2;
+    }
+    if (point < 0x10000) {
+        dst[0] = 0xE0 | point >> 12;
+        dst[1] = 0x80 | (point >> 6 & 0x3F);
+        dst[2] = 0x80 | (point & 0x3F);
+        return 3;
+    }
+    dst[0] = 0xF0 | point >> 18;
+    dst[1] = 0x80 | (point >> 12 & 0x3F);
+    dst[2] = 0x80 | (point >> 6 & 0x3F);
+    dst[3] = 0x80 | (point & 0x3F);
+    return 4;
+}
+
+/* Unescapes contents of string into buffer of at least 'len' + 1 bytes, terminating it
+ * Contents must have been scanned by jscan_string_span().
+ * Returns length of unescaped string
+ * Returns SIZE_MAX and sets errno to EILSEQ if an escape sequence is invalid,
+ * or if the string holds U+0000 */
+static size_t jstring_unescape(char *restrict dst, const char *restrict src, size_t len) {
+    const char *const END = src + len;
+    char *const BEGIN = dst;
+    long point, low;
+
+    while (src < END) {
+        const char *const ESCAPE = memchr(src, '\\', END - src);
+        const size_t RUN = (ESCAPE ? ESCAPE : END) - src;
+
+        memcpy(dst, src, RUN);  // Copy run preceding escape at once
+        dst += RUN;
+        if (!ESCAPE)
+            break;
+        src = ESCAPE;
+        switch (src[1]) {   // Always present, as the closing quote cannot be escaped
+        case '"':   *dst++ = '"';   break;
+        case '\\':  *dst++ = '\\';  break;
+        case '/':   *dst++ = '/';   break;
+        case 'b':   *dst++ = '\b';  break;
+        case 'f':   *dst++ = '\f';  break;
+        case 'n':   *dst++ = '\n';  break;
+        case 'r':   *dst++ = '\r';  break;
+        case 't':   *dst++ = '\t';  break;
+        case 'u':
+            if (END - src < 6 || (point = jhex_decode(src + 2)) <= 0)
+                jscan_fail(SIZE_MAX);   // Invalid digits || U+0000
+            src += 6;
+            if (point >= 0xD800 && point < 0xDC00) {    // High surrogate
+                if (END - src < 6 || src[0] != '\\' || src[1] != 'u' ||
+                  (low = jhex_decode(src + 2)) < 0xDC00 || low > 0xDFFF)
+                    jscan_fail(SIZE_MAX);   // Not followed by low surrogate
+                point = 0x10000 + ((point - 0xD800) << 10) + (low - 0xDC00);
+                src += 6;
+            } else if (point >= 0xDC00 && point < 0xE000)   // Unpaired low surrogate
+                jscan_fail(SIZE_MAX);
+            dst += jutf8_encode(dst, point);
+            continue;
+        default:
+            jscan_fail(SIZE_MAX);
+        }
+        src += 2;
+    }
+    *dst = '\0';
+    return dst - BEGIN;
+}
+
+/* Returns length of escape sequence beginning a string, or 0 if it is invalid
+ * Surrogates escaped by \\u must form pairs. */
+static size_t jescape_length(const char *string, const char *end) {
+    long point, low;
+
+    if (end - string < 2)
+        return 0;
+    switch (string[1]) {
+    case '"': case '\\': case '/': case 'b': case 'f': case 'n': case 'r': case 't':
+        return 2;
+    case 'u':
+        if (end - string < 6 || (point = jhex_decode(string + 2)) < 0)
+            return 0;
+        if (point < 0xD800 || point >= 0xE000)
+            return 6;
+        if (point >= 0xDC00 || end - string < 12 || string[6] != '\\' ||
+          string[7] != 'u' || (low = jhex_decode(string + 8)) < 0xDC00 || low > 0xDFFF)
+            return 0;   // Unpaired surrogate
+        return 12;
+    default:
+        return 0;
+    }
+}
+
+/* Validates string, including its escape sequences and UTF-8
+ * On error, leaves scanner at the offending byte */
+static bool jvalidate_string(jscanner_t *scanner) {
+    if (!jscan_char(scanner, '"'))
+        return false;
+
+    const char *pos = scanner->pos, *const END = scanner->end;
+    size_t len;
+
+    for (;;) {
+        pos += jstring_span(pos, END, true);
+        if (pos == END)
+            break;
+        if (*pos == '"') {
+            scanner->pos = pos + 1;
+            return true;
+        }
+        if (*pos == '\\')
+            len = jescape_length(pos, END);
+        else if ((unsigned char) *pos < 0x20)   // Control character
+            break;
+        else
+            len = jutf8_length(pos, END);
+        if (!len)
+            break;
+        pos += len;
+    }
+    scanner->pos = pos;
+    jscan_fail(false);
+}
+
+/* Validates a single JSON value, followed only by whitespace
+ * Containers are tracked on a bit stack rather than by recursion.
+ * On error, leaves scanner at the offending byte */
+static bool jvalidate_document(jscanner_t *scanner) {
+    uint64_t stack[(JSON_MAXDEPTH + 63) / 64];
+    size_t depth = 0;
+    bool flag;
+    char c;
+
+    for (;;) {
+        switch (c = jscan_space(scanner)) {     // Expect value
+        case '"':
+            if (!jvalidate_string(scanner))
+                return false;
+            break;
+        case 't':
+        case 'f':
+        case 'n':
+            if (!jscan_literal(scanner, c == 't' ? "true" : c == 'f' ? "false" : "null"))
+                return false;
+            break;
+        case '[':
+        case '{':
+            if (depth == JSON_MAXDEPTH)
+                jscan_fail(false);
+            jdepth_set(stack, depth, c == '{');
+            ++depth;
+            ++scanner->pos;
+            if (jscan_space(scanner) == (c == '{' ? '}' : ']')) {   // Empty
+                ++scanner->pos;
+                --depth;
+                break;
+            }
+            if (c == '{' && (!jvalidate_string(scanner) || !jscan_char(scanner, ':')))
+                return false;
+            continue;
+        default:
+            if (!jscan_number_span(scanner, &flag))
+                return false;
+        }
+        for (;;) {      // Value complete; close containers until another is expected
+            c = jscan_space(scanner);
+            if (!depth) {
+                if (scanner->pos != scanner->end)   // Trailing characters
+                    jscan_fail(false);
+                return true;
+            }
+            if (c == ',') {
+                ++scanner->pos;
+                if (jdepth_get(stack, depth - 1) &&
+                  (!jvalidate_string(scanner) || !jscan_char(scanner, ':')))
+                    return false;
+                break;
+            }
+            if (c != (jdepth_get(stack, depth - 1) ? '}' : ']'))
+                jscan_fail(false);
+            ++scanner->pos;
+            --depth;
+        }
+    }
+}
+
+/* Scans string, returning its unescaped contents, allocated with malloc()
+ * Returns NULL and sets errno accordingly on error */
+static char *jscan_string(jscanner_t *scanner) {
+    const char *contents;
+    bool escaped;
+    const size_t SPAN = jscan_string_span(scanner, &contents, &escaped);
+
+    if (SPAN == SIZE_MAX)   // jscan_string_span() fails
+        return NULL;
+
+    char *string = malloc(SPAN + 1);    // Unescaping never lengthens a string
+    size_t len = SPAN;
+
+    if (!string)    // malloc() fails
+        return NULL;
+    if (escaped) {
+        len = jstring_unescape(string, contents, SPAN);
+        if (len == SIZE_MAX) {  // jstring_unescape() fails
+            free(string);
+            return NULL;
+        }
+    } else {
+        memcpy(string, contents, SPAN);
+        string[SPAN] = '\0';
+    }
+    jstat_alloc(strings, len + 1);
+    return string;
+}
+
+/* Scans string into buffer of given size, terminating it
+ * Returns false and sets errno accordingly on error,
+ * or to ERANGE if it does not fit */
+static bool jscan_chars(jscanner_t *scanner, char *buffer, size_t size) {
+    const char *contents;
+    bool escaped;
+    const size_t SPAN = jscan_string_span(scanner, &contents, &escaped);
+
+    if (SPAN == SIZE_MAX)   // jscan_string_span() fails
+        return false;
+    if (!escaped) {
+        if (SPAN >= size)
+            error(ERANGE, false);
+        memcpy(buffer, contents, SPAN);
+        buffer[SPAN] = '\0';
+        return true;
+    }
+
+    char *string = malloc(SPAN + 1);    // Unescaped apart, so buffer is untouched on error
+    size_t len;
+
+    if (!string)    // malloc() fails
+        return false;
+    len = jstring_unescape(string, contents, SPAN);
+    if (len != SIZE_MAX && len < size)
+        memcpy(buffer, string, len + 1);
+    free(string);
+    if (len == SIZE_MAX)    // jstring_unescape() fails
+        return false;
+    if (len >= size)
+        error(ERANGE, false);
+    return true;
+}
+
+/* Skips value of any type held by an array or object at given depth
+ * Escape sequences of skipped strings are not validated.
+ * Returns false and sets errno accordingly on error */
+static bool jscan_skip(jscanner_t *scanner, size_t depth) {
+    const char *contents;
+    bool flag;
+    char close;
+
+    switch (jscan_space(scanner)) {
+    case '"':   return jscan_string_span(scanner, &contents, &flag) != SIZE_MAX;
+    case 't':   return jscan_literal(scanner, "true");
+    case 'f':   return jscan_literal(scanner, "false");
+    case 'n':   return jscan_literal(scanner, "null");
+    case '[':
+    case '{':
+        if (depth >= JSON_MAXDEPTH)
+            jscan_fail(false);
+        close = *scanner->pos++ == '[' ? ']' : '}';
+        if (jscan_space(scanner) == close) {
+            ++scanner->pos;
+            return true;
+        }
+        for (;;) {
+            if (close == '}' && (jscan_string_span(scanner, &contents, &flag) == SIZE_MAX
+              || !jscan_char(scanner, ':')))
+                return false;
+            if (!jscan_skip(scanner, depth + 1))
+                return false;
+            if (jscan_space(scanner) != ',')
+                return jscan_char(scanner, close);
+            ++scanner->pos;
+        }
+    default:
+        return jscan_number_span(scanner, &flag) != 0;
+    }
+}
+
+/* Adds entry to object, taking ownership of key and value
+ * If the key is present, its value is replaced and the given key is freed.
+ * Returns false and sets errno accordingly on error */
+static bool json_put(json_t *json, char *key, jvalue_t *value) {
+    const jinfo_t INFO = json_seek(json->root, key);
+
+    jvalue_attach(value, &json->node);
+    jnode_invalidate(&json->node);
+    if (INFO.target) {
+        jstring_free(key);
+        jvalue_free(INFO.target->value);
+        INFO.target->value = value;
+        return true;
+    }
+
+    jentry_t *new_entry = malloc(sizeof(jentry_t));
+
+    if (!new_entry) // malloc() fails
+        return false;
+    jstat_alloc(entries, sizeof(jentry_t));
+    new_entry->height = 0;
+    new_entry->key = key;
+    new_entry->value = value;
+    new_entry->parent = INFO.parent;
+    new_entry->lchild = new_entry->rchild = NULL;
+    ++json->size;
+    if (!INFO.parent) {
+        json->root = new_entry;
+        return true;
+    }
+    if (INFO.dif < 0)   INFO.parent->lchild = new_entry;
+    else                INFO.parent->rchild = new_entry;
+    json->root = json_balance(INFO.parent);
+    return true;
+}
+
+/* Parses array at given depth, beginning at its opening bracket
+ * Returns NULL and sets errno accordingly on error */
+static jarray_t *jparse_array(jscanner_t *scanner, size_t depth) {
+    if (depth > JSON_MAXDEPTH)
+        jscan_fail(NULL);
+
+    jarray_t *array = jarray_new();
+    jvalue_t *value;
+
+    if (!array) // jarray_new() fails
+        return NULL;
+    ++scanner->pos;
+    if (jscan_space(scanner) == ']') {
+        ++scanner->pos;
+        return array;
+    }
+    for (;;) {
+        if (!(value = jparse_value(scanner, depth)) || !jarray_append(array, value)) {
+            if (value)
+                jvalue_free(value);
+            jarray_free(array);
+            return NULL;
+        }   // jparse_value() fails || jarray_append() fails
+        if (jscan_space(scanner) != ',')
+            break;
+        ++scanner->pos;
+    }
+    if (!jscan_char(scanner, ']')) {
+        jarray_free(array);
+        return NULL;
+    }
+    return array;
+}
+
+/* Parses object at given depth, beginning at its opening brace
+ * Returns NULL and sets errno accordingly on error */
+static json_t *jparse_json(jscanner_t *scanner, size_t depth) {
+    if (depth > JSON_MAXDEPTH)
+        jscan_fail(NULL);
+
+    json_t *json = json_new();
+    jvalue_t *value = NULL;
+    char *key;
+
+    if (!json)  // json_new() fails
+        return NULL;
+    ++scanner->pos;
+    if (jscan_space(scanner) == '}') {
+        ++scanner->pos;
+        return json;
+    }
+    for (;;) {
+        if (!(key = jscan_string(scanner)) || !jscan_char(scanner, ':') ||
+          !(value = jparse_value(scanner, depth)) || !json_put(json, key, value)) {
+            if (key)
+                jstring_free(key);
+            if (value)
+                jvalue_free(value);
+            json_free(json);
+            return NULL;
+        }   // jscan_string() fails || jscan_char() fails ||
+            // jparse_value() fails || json_put() fails
+        value = NULL;
+        if (jscan_space(scanner) != ',')
+            break;
+        ++scanner->pos;
+    }
+    if (!jscan_char(scanner, '}')) {
+        json_free(json);
+        return NULL;
+    }
+    return json;
+}
+
+/* Parses value held by an array or object at given depth
+ * Returns NULL and sets errno accordingly on error */
+static jvalue_t *jparse_value(jscanner_t *scanner, size_t depth) {
+    jvalue_t *value = malloc(sizeof(jvalue_t));
+    bool success;
+
+    if (!value) // malloc() fails
+        return NULL;
+    switch (jscan_space(scanner)) {
+    case '"':
+        value->type = J_STR;
+        success = (value->value.string = jscan_string(scanner));
+        break;
+    case 't':
+    case 'f':
+        value->type = J_BOOL;
+        value->value.boolean = *scanner->pos == 't';
+        success = jscan_literal(scanner, value->value.boolean ? "true" : "false");
+        break;
+    case 'n':
+        value->type = J_NULL;
+        success = jscan_literal(scanner, "null");
+        break;
+    case '[':
+        value->type = J_ARR;
+        success = (value->value.array = jparse_array(scanner, depth + 1));
+        break;
+    case '{':
+        value->type = J_OBJ;
+        success = (value->value.object = jparse_json(scanner, depth + 1));
+        break;
+    default:
+        value->type = J_NUM;
+        success = jscan_number(scanner, &value->value.number);
+    }
+    if (!success) {
+        free(value);
+        return NULL;
+    }
+    jstat_alloc(values, sizeof(jvalue_t));
+    jvalue_attach(value, NULL);
+    return value;
+}
+
+/* Parses input holding a single object
+ * Returns NULL and sets errno accordingly on error */
+static json_t *jparse_document(jscanner_t *scanner) {
+    if (jscan_space(scanner) != '{')
+        jscan_fail(NULL);
+
+    json_t *json = jparse_json(scanner, 1);
+
+    if (!json)  // jparse_json() fails
+        return NULL;
+    jscan_space(scanner);
+    if (scanner->pos != scanner->end) {    // Trailing characters
+        json_free(json);
+        jscan_fail(NULL);
+    }
+    return json;
+}
+
+/* Reads remainder of file into buffer allocated with malloc()
+ * Returns NULL and sets errno accordingly on error */
+static char *jfile_read(FILE *restrict file, size_t *len) {
+    size_t size = 0, capacity = BUFSIZ;
+    char *buffer = malloc(capacity), *new_buffer;
+
+    if (!buffer)    // malloc() fails
+        return NULL;
+    while ((size += fread(buffer + size, 1, capacity - size, file)) == capacity) {
+        if (capacity > SIZE_MAX / 2) {
+            free(buffer);
+            error(E2BIG, NULL);
+        }
+        if (!(new_buffer = realloc(buffer, capacity * 2))) {
+            free(buffer);
+            return NULL;
+        }   // realloc() fails
+        buffer = new_buffer;
+        capacity *= 2;
+    }
+    if (ferror(file)) {
+        free(buffer);
+        error(EIO, NULL);
+    }
+    *len = size;
+    return buffer;
+}
+
+/* Writes string as JSON string, escaping characters as required by RFC 8259
+ * Runs of characters needing no escape are found by jstring_span(). Short runs
+ * and escape sequences are gathered in a buffer, so that strings dense with
+ * escapes are written in a few calls rather than one per character. */
+static void jstring_write(const char *string, size_t len, FILE *restrict file) {
+    static const char HEX[] = "0123456789abcdef";
+    const char *const END = string + len;
+    char buffer[JSTRING_WRITEBUF];
+    size_t used = 0;
+
+    buffer[used++] = '"';
+    for (;;) {
+        const size_t RUN = jstring_span(string, END, false);
+
+        if (used + RUN > JSTRING_WRITEBUF - JESCAPE_MAX) {  // Keep room for an escape
+            fwrite(buffer, 1, used, file);
+            used = 0;
+        }
+        if (RUN > JSTRING_WRITEBUF - JESCAPE_MAX)   // Too long to gather
+            fwrite(string, 1, RUN, file);
+        else {
+            memcpy(buffer + used, string, RUN);
+            used += RUN;
+        }
+        if ((string += RUN) == END)
+            break;
+
+        const unsigned char C = *string++;
+
+        buffer[used++] = '\\';
+        switch (C) {
+        case '"':   buffer[used++] = '"';   break;
+        case '\\':  buffer[used++] = '\\';  break;
+        case '\b':  buffer[used++] = 'b';   break;
+        case '\f':  buffer[used++] = 'f';   break;
+        case '\n':  buffer[used++] = 'n';   break;
+        case '\r':  buffer[used++] = 'r';   break;
+        case '\t':  buffer[used++] = 't';   break;
+        default:    // Other control characters
+            memcpy(buffer + used, "u00", 3);
+            buffer[used + 3] = HEX[C >> 4];
+            buffer[used + 4] = HEX[C & 0xF];
+            used += 5;
+        }
+    }
+    buffer[used++] = '"';
+    fwrite(buffer, 1, used, file);
+}
+
+// Writes value as compact JSON
+static void jvalue_write(const jvalue_t *value, FILE *restrict file) {
+    const json_t *json;
+
+    switch (value->type) {
+    case J_BOOL:    fputs(value->value.boolean ? "true" : "false", file);   break;
+    case J_NUM:     jfloat_print(value->value.number, file);                break;
+    case J_NULL:    fputs("null", file);                                    break;
+    case J_STR:
+        jstring_write(value->value.string, strlen(value->value.string), file);
+        break;
+    case J_ARR:
+        fputc('[', file);
+        for (size_t i = 0; i < value->value.array->size; ++i) {
+            if (i)
+                fputc(',', file);
+            jvalue_write(value->value.array->values[i], file);
+        }
+        fputc(']', file);
+        break;
+    case J_OBJ:
+        json = value->value.object;
+        fputc('{', file);
+        for (jentry_t *entry = json->root ? json_smallest(json->root) : NULL;
+          entry; entry = json_next(entry)) {
+            jstring_write(entry->key, strlen(entry->key), file);
+            fputc(':', file);
+            jvalue_write(entry->value, file);
+            if (json_next(entry))
+                fputc(',', file);
+        }
+        fputc('}', file);
+    }
+}
+
+// Returns hash of key under seed of schema
+static uint64_t jschema_hash(const jschema_t *schema, const char *key, size_t len) {
+    uint64_t hash = jhash_bytes(0xcbf29ce484222325u ^ schema->seed, key, len);
+
+    hash ^= hash >> 33;     // Spread high bits downward, as FNV-1a leaves them weak
+    hash *= 0xff51afd7ed558ccdu;
+    return hash ^ hash >> 33;
+}
+
+/* Finds displacement of bucket placing each of its keys in a free slot
+ * Returns false if there is none */
+static bool jschema_place(jschema_t *schema, size_t bucket, const uint64_t *hashes) {
+    for (uint32_t displace = 0; displace <= UINT16_MAX; ++displace) {
+        bool fits = true;
+
+        schema->displace[bucket] = displace;
+        for (size_t i = 0; i < schema->count && fits; ++i) {
+            if (jschema_bucket(schema, hashes[i]) != bucket)
+                continue;
+
+            unsigned char *slot = schema->table + jschema_slot(schema, hashes[i]);
+
+            if (*slot)
+                fits = false;
+            else
+                *slot = i + 1;
+        }
+        if (fits)
+            return true;
+        for (size_t i = 0; i < schema->count; ++i) {    // Undo placement
+            unsigned char *slot = schema->table + jschema_slot(schema, hashes[i]);
+
+            if (jschema_bucket(schema, hashes[i]) == bucket && *slot == i + 1)
+                *slot = 0;
+        }
+    }
+    return false;
+}
+
+// Returns field of schema stored under key, or NULL if there is none
+static const jfield_t *jschema_lookup(const jschema_t *schema, const char *key, size_t len) {
+    const uint64_t HASH = jschema_hash(schema, key, len);
+    const unsigned char INDEX = schema->table[jschema_slot(schema, HASH)];
+
+    if (!INDEX)
+        return NULL;
+
+    const jfield_t *field = schema->fields + INDEX - 1;
+
+    return !strncmp(field->key, key, len) && !field->key[len] ? field : NULL;
+}
+
+// Returns number of structs described by schema, counting nested ones
+static size_t jschema_objects(const jschema_t *schema) {
+    size_t objects = 1;
+
+    for (size_t i = 0; i < schema->count; ++i) {
+        if (schema->fields[i].type == JF_OBJ)
+            objects += jschema_objects(schema->fields[i].schema);
+    }
+    return objects;
+}
+
+/* Returns masks of fields decoded within nested struct of given field
+ * Masks of a struct are laid out in pre-order: its own mask comes first,
+ * followed by those of each nested struct in order of their fields. */
+static uint64_t *jschema_nested(const jschema_t *schema,
+  const jfield_t *field, uint64_t *seen) {
+    ++seen;
+    for (const jfield_t *prior = schema->fields; prior != field; ++prior) {
+        if (prior->type == JF_OBJ)
+            seen += jschema_objects(prior->schema);
+    }
+    return seen;
+}
+
+static void jschema_free_fields(const jschema_t *schema, void *object, uint64_t *seen);
+
+/* Frees member of struct described by field, if it was allocated by decoder
+ * 'seen' holds masks of fields decoded, as laid out by jschema_nested(),
+ * or is NULL if every member was allocated by decoder.
+ * Freed pointers are set to NULL, and their fields are cleared from 'seen'. */
+static void jschema_free_field(const jschema_t *schema,
+  const jfield_t *field, void *object, uint64_t *seen) {
+    const uint64_t FLAG = (uint64_t) 1 << (field - schema->fields);
+    void *const MEMBER = jfield_member(object, field);
+
+    if (field->type == JF_OBJ) {    // Members of nested struct are tracked on their own
+        jschema_free_fields(field->schema, MEMBER,
+          seen ? jschema_nested(schema, field, seen) : NULL);
+        return;
+    }
+    if (seen && !(*seen & FLAG))
+        return;
+    if (field->type == JF_STR) {
+        if (*(char **) MEMBER)
+            jstring_free(*(char **) MEMBER);
+        *(char **) MEMBER = NULL;
+    } else if (field->type == JF_VALUE) {
+        if (*(jvalue_t **) MEMBER)
+            jvalue_free(*(jvalue_t **) MEMBER);
+        *(jvalue_t **) MEMBER = NULL;
+    }
+    if (seen)
+        *seen &= ~FLAG;
+}
+
+// Frees members of struct allocated by decoder, as described by jschema_free_field()
+static void jschema_free_fields(const jschema_t *schema, void *object, uint64_t *seen) {
+    for (size_t i = 0; i < schema->count; ++i)
+        jschema_free_field(schema, schema->fields + i, object, seen);
+}
+
+/* Decodes value into member described by field of schema
+ * Returns false and sets errno accordingly on error */
+static bool jschema_decode_field(jschema_t *schema, const jfield_t *field,
+  jscanner_t *scanner, void *member, size_t depth, uint64_t *seen) {
+    char *string;
+    jvalue_t *value;
+    bool boolean;
+
+    switch (field->type) {  // Member is assigned only once its value is known to be valid
+    case JF_BOOL:
+        boolean = jscan_space(scanner) == 't';
+        if (!jscan_literal(scanner, boolean ? "true" : "false"))
+            return false;
+        *(bool *) member = boolean;
+        return true;
+    case JF_INT:
+        return jscan_integer(scanner, member);
+    case JF_NUM:
+        return jscan_number(scanner, member);
+    case JF_STR:
+        if (jscan_space(scanner) == 'n') {
+            if (!jscan_literal(scanner, "null"))
+                return false;
+            *(char **) member = NULL;
+            return true;
+        }
+        if (!(string = jscan_string(scanner)))
+            return false;   // jscan_string() fails
+        *(char **) member = string;
+        return true;
+    case JF_CHARS:
+        return jscan_chars(scanner, member, field->size);
+    case JF_OBJ:
+        return jschema_decode_object(field->schema,
+          scanner, member, depth + 1, jschema_nested(schema, field, seen));
+    case JF_VALUE:
+        if (!(value = jparse_value(scanner, depth)))
+            return false;   // jparse_value() fails
+        *(jvalue_t **) member = value;
+        return true;
+    }
+    error(EINVAL, false);
+}
+
+/* Decodes members of object at given depth, flagging fields decoded in 'seen'
+ * 'seen' is laid out as described by jschema_nested().
+ * Returns false and sets errno accordingly on error */
+static bool jschema_decode_members(jschema_t *schema,
+  jscanner_t *scanner, void *object, size_t depth, uint64_t *seen) {
+    const char *key;
+    char *unescaped;
+    const jfield_t *field;
+    bool escaped;
+    size_t len, index;
+
+    if (depth > JSON_MAXDEPTH)
+        jscan_fail(false);
+    if (!jscan_char(scanner, '{'))
+        return false;
+    if (jscan_space(scanner) == '}') {
+        ++scanner->pos;
+        return true;
+    }
+    for (;;) {
+        if ((len = jscan_string_span(scanner, &key, &escaped)) == SIZE_MAX)
+            return false;   // jscan_string_span() fails
+        if (escaped) {      // Compare keys once unescaped
+            if (!(unescaped = malloc(len + 1)))
+                return false;   // malloc() fails
+            len = jstring_unescape(unescaped, key, len);
+            field = len != SIZE_MAX ? jschema_lookup(schema, unescaped, len) : NULL;
+            free(unescaped);
+            if (len == SIZE_MAX)    // jstring_unescape() fails
+                return false;
+        } else
+            field = jschema_lookup(schema, key, len);
+        if (!jscan_char(scanner, ':'))
+            return false;
+        if (!field) {
+            if (!jscan_skip(scanner, depth))
+                return false;   // jscan_skip() fails
+        } else {
+            index = field - schema->fields;
+            if (*seen >> index & 1)     // Repeated key, of which the last is kept
+                jschema_free_field(schema, field, object, seen);
+            if (!jschema_decode_field(schema,
+              field, scanner, jfield_member(object, field), depth, seen))
+                return false;   // jschema_decode_field() fails
+            *seen |= (uint64_t) 1 << index;
+        }
+        if (jscan_space(scanner) != ',')
+            break;
+        ++scanner->pos;
+    }
+    if (!jscan_char(scanner, '}'))
+        return false;
+    for (size_t i = 0; i < schema->count; ++i) {
+        if (schema->fields[i].required && !(*seen >> i & 1))
+            jscan_fail(false);
+    }
+    if (depth == 1 && (jscan_space(scanner), scanner->pos != scanner->end))
+        jscan_fail(false);  // Trailing characters
+    return true;
+}
+
+/* Decodes object at given depth into struct, flagging fields decoded in 'seen'
+ * Returns false and sets errno accordingly on error */
+static bool jschema_decode_object(jschema_t *schema,
+  jscanner_t *scanner, void *object, size_t depth, uint64_t *seen) {
+    if (!schema->slots && !jschema_compile(schema))
+        return false;   // jschema_compile() fails
+    return jschema_decode_members(schema, scanner, object, depth, seen);
+}
+
+// Encodes struct as compact JSON object
+static void jschema_encode_object(const jschema_t *schema,
+  const void *object, FILE *restrict file) {
+    fputc('{', file);
+    for (size_t i = 0; i < schema->count; ++i) {
+        const jfield_t *field = schema->fields + i;
+        const char *member = (const char *) object + field->offset, *string, *end;
+        const jvalue_t *value;
+
+        if (i)
+            fputc(',', file);
+        jstring_write(field->key, strlen(field->key), file);
+        fputc(':', file);
+        switch (field->type) {
+        case JF_BOOL:   fputs(*(const bool *) member ? "true" : "false", file); break;
+        case JF_INT:    fprintf(file, "%lld", *(const long long *) member);     break;
+        case JF_NUM:    jfloat_print(*(const jfloat_t *) member, file);         break;
+        case JF_OBJ:    jschema_encode_object(field->schema, member, file);     break;
+        case JF_STR:
+            if ((string = *(char *const *) member))
+                jstring_write(string, strlen(string), file);
+            else
+                fputs("null", file);
+            break;
+        case JF_CHARS:
+            end = memchr(member, '\0', field->size);
+            jstring_write(member, end ? (size_t) (end - member) : field->size, file);
+            break;
+        case JF_VALUE:
+            if ((value = *(jvalue_t *const *) member))
+                jvalue_write(value, file);
+            else
+                fputs("null", file);
+        }
+    }
+    fputc('}', file);
+}
+
+void jarray_free(jarray_t *array) {
+    if (array) {
+        for (size_t i = 0; i < array->size; ++i)
+            jvalue_free(array->values[i]);
+        jstat_free(arrays, sizeof(jarray_t) + array->capacity * sizeof(jvalue_t *));
+        free(array->values);
+        free(array);
+    }
+}
+void json_free(json_t *json) {
+    if (json) {  // Do not free NULL
+        if (json->root)
+            jentry_free(json->root);
+        jstat_free(objects, sizeof(json_t));
+        free(json);
+    }
+}
+void jvalue_free(jvalue_t *value) {
+    if (value) {
+        switch (value->type) {
+        case J_STR: jstat_free(strings, strlen(value->value.string) + 1);
+                    free(value->value.string);          break;
+        case J_ARR: jarray_free(value->value.array);    break;
+        case J_OBJ: json_free(value->value.object);
+        }
+        jstat_free(values, sizeof(jvalue_t));
+        free(value);
+    }
+}
+void jshared_free(jshared_t *shared) {
+    if (shared) {
+        jreader_t *reader = atomic_load(&shared->readers), *next_reader;
+        jretired_t *retired = atomic_load(&shared->retired), *next_retired;
+        json_t *const CURRENT = atomic_load(&shared->current);
+
+        while (reader) {
+            next_reader = reader->next;
+            free(reader);
+            reader = next_reader;
         }
-        free(value);
+        while (retired) {
+            next_retired = retired->next;
+            json_free(retired->json);
+            free(retired);
+            retired = next_retired;
+        }
+        if (CURRENT)    // Version may have been withdrawn by publishing NULL
+            json_free(CURRENT);
+        free(shared);
+    }
+}
+void jshared_leave(jreader_t *reader) {
+    atomic_store_explicit(&reader->epoch, 0, memory_order_release);
+}
+void jshared_unregister(jreader_t *reader) {
+    if (reader) {
+        atomic_store(&reader->epoch, 0);
+        atomic_store(&reader->active, false);
     }
 }
+void jschema_free(const jschema_t *schema, void *object) {
+    if (schema && object)
+        jschema_free_fields(schema, object, NULL);
+}
 bool jarray_pushb(jarray_t *array, const jvalue_t *restrict value) {
     if (!array || !value)
         error(EINVAL, false);
-    if (array->size == SIZE_MAX /
-      sizeof(jvalue_t *))   // Array takes up more than SIZE_MAX bytes
-        error(E2BIG, false);
-    if (array->size == array->capacity)
-        realloc(array->values, array->capacity *= 2);
-    array->values[array->size++] = jvalue_copy(value);
+    if (array->size == array->capacity && !jarray_grow(array))
+        return false;   // jarray_grow() fails
+
+    jvalue_t *new_value = jvalue_copy(value);
+
+    if (!new_value) // jvalue_copy() fails
+        return false;
+    jvalue_attach(new_value, &array->node);
+    jnode_invalidate(&array->node);
+    array->values[array->size++] = new_value;
     return true;
 }
 bool jarray_pushf(jarray_t *array, const jvalue_t *restrict value) {
     if (!array || !value)
         error(EINVAL, false);
-    if (array->size == SIZE_MAX / sizeof(jvalue_t *))
-        error(E2BIG, false);
-    if (array->size == array->capacity)
-        realloc(array->values, array->capacity *= 2);
-    ++array->size;
-    for (size_t i = 1; i < array->size; ++i)    // Shift members forward
+    if (array->size == array->capacity && !jarray_grow(array))
+        return false;   // jarray_grow() fails
+
+    jvalue_t *new_value = jvalue_copy(value);
+
+    if (!new_value) // jvalue_copy() fails
+        return false;
+    jvalue_attach(new_value, &array->node);
+    jnode_invalidate(&array->node);
+    for (size_t i = array->size; i; --i)    // Shift members forward
         array->values[i] = array->values[i - 1];
-    array->values[0] = jvalue_copy(value);
+    array->values[0] = new_value;
+    ++array->size;
+    return true;
+}
+bool jarray_pushb_move(jarray_t *array, jvalue_t *value) {
+    if (!array || !value)
+        error(EINVAL, false);
+    if (!jarray_append(array, value)) {
+        jvalue_free(value);
+        return false;
+    }   // jarray_append() fails
     return true;
 }
 bool jarray_remove(jarray_t *restrict array, size_t index) {
@@ -344,50 +2557,91 @@ bool jarray_remove(jarray_t *restrict array, size_t index) {
         error(EINVAL, false);
     if (!array->size || index > array->size - 1)   // Index is out-of-bounds
         error(ENOENT, false);
-    free(array->values[index]);
-    for (size_t i = array->size - 1;; --i) {                // Shift members backward
-        array->values[i] = i + 1 == array->size ? NULL : array->values[i + 1];
-        if (i == index)
-            break;
-    }
-    --array->size;
+    jnode_invalidate(&array->node);
+    jvalue_free(array->values[index]);
+    for (size_t i = index + 1; i < array->size; ++i)   // Shift members backward
+        array->values[i - 1] = array->values[i];
+    array->values[--array->size] = NULL;
     return true;
 }
 bool jarray_sort(jarray_t *restrict array) {
     if (!array)
         error(EINVAL, false);
     
-    const jtype_t TYPE = array->values[0]->type;
+    const char TYPE = array->values[0]->type;
 
     for (size_t i = 1; i < array->size; ++i) {  // Ensures types are identical
         if (array->values[i]->type != TYPE)
             error(EOPNOTSUPP, false);
     }
-    qsort(array->values, array->size, sizeof(jvalue_t *), jvalue_getcmp(TYPE));
+    jnode_invalidate(&array->node);
+    qsort(array->values, array->size, sizeof(jvalue_t *), jvalue_sortcmp);
     return true;
 }
 bool json_add(json_t *json, const char *key, const jvalue_t *value) {
     if (!json || !key || !value)
         error(EINVAL, false);
-    if (!json->root) {                          // Create root node
-        json->root = jentry_new(NULL, strdup(key), value);
-        if (!json->root)
+
+    const jinfo_t INFO = json_seek(json->root, key);
+
+    if (INFO.target) {                          // Replace existing value
+        jvalue_t *new_value = jvalue_copy(value);
+
+        if (!new_value) // jvalue_copy() fails
             return false;
+        jvalue_attach(new_value, &json->node);
+        jnode_invalidate(&json->node);
+        jvalue_free(INFO.target->value);
+        INFO.target->value = new_value;
+        return true;
+    }
+
+    jentry_t *new_entry = jentry_new(json, INFO.parent, key, value);
+
+    if (!new_entry) // jentry_new() fails
+        return false;
+    jnode_invalidate(&json->node);
+    ++json->size;
+    if (!INFO.parent) {                         // Create root node
+        json->root = new_entry;
         return true;
     }
+    if (INFO.dif < 0)   INFO.parent->lchild = new_entry;
+    else                INFO.parent->rchild = new_entry;
+    json->root = json_balance(INFO.parent);
+    return true;
+}
+bool json_add_move(json_t *json, const char *key, size_t len, jvalue_t *value) {
+    if (!json || !key || !value)
+        error(EINVAL, false);
 
-    jinfo_t *info = json_seek(json->root, key, true);   // link node to tree
+    jentry_t *target = json_seek_len(json->root, key, len).target;
+    char *new_key;
 
-    if (!info) // json_seek() fails
+    if (target) {                               // Replace existing value
+        jvalue_attach(value, &json->node);
+        jnode_invalidate(&json->node);
+        jvalue_free(target->value);
+        target->value = value;
+        return true;
+    }
+    if (!(new_key = malloc(len + 1))) {
+        jvalue_free(value);
         return false;
-    info->target->value = value;
-    json_balance(json->root);
-    free(info);
+    }   // malloc() fails
+    memcpy(new_key, key, len);
+    new_key[len] = '\0';
+    jstat_alloc(strings, strlen(new_key) + 1);
+    if (!json_put(json, new_key, value)) {
+        jstring_free(new_key);
+        jvalue_free(value);
+        return false;
+    }   // json_put() fails
     return true;
 }
 
-//
-static void indent_print(const FILE *restrict file,
+// Prints indentation, followed by formatted text
+static void indent_print(FILE *restrict file,
   size_t indent, const char *restrict fmt, ...) {
     va_list args;
 
@@ -395,128 +2649,350 @@ static void indent_print(const FILE *restrict file,
         fputs("    ", file);
         --indent;
     }
-    va_start(args, file);
+    va_start(args, fmt);
     vfprintf(file, fmt, args);
     va_end(args);
 }
 
-//
+// Prints array, with members on their own lines one level deeper than its brackets
 static void jarray_print(const jarray_t *restrict array,
-  const FILE *restrict file, size_t indent) {
-    indent_print(file, indent, "[\n");
+  FILE *restrict file, size_t indent) {
+    if (!array->size) {
+        fputs("[]", file);
+        return;
+    }
+    fputs("[\n", file);
     for (size_t i = 0; i < array->size; ++i) {
+        indent_print(file, indent + 1, "");
         jvalue_print(array->values[i], file, indent + 1);
         fputs(i != array->size - 1 ? ",\n" : "\n", file);
     }
-    indent_print(file, indent, "]\n");
+    indent_print(file, indent, "]");
 }
 
-//
-static void jfloat_print(jfloat_t number, const FILE *restrict file) {
-    
+/* Prints number with the fewest digits that are read back exactly, or null if it is not finite
+ * Starts from JFLT_DIG digits, which suffice for most numbers and print 0.1 as such,
+ * adding one at a time up to JFLT_PRINT_DIG, which always suffice. */
+static void jfloat_print(jfloat_t number, FILE *restrict file) {
+    char buffer[JFLT_PRINTBUF];
+
+    if (!isfinite(number)) {
+        fputs("null", file);
+        return;
+    }
+    for (int digits = JFLT_DIG; digits <= JFLT_PRINT_DIG; ++digits) {
+        snprintf(buffer, sizeof buffer, "%.*Lg", digits, (long double) number);
+        if (jfloat_strto(buffer, NULL) == number)
+            break;
+    }
+    fputs(buffer, file);
 }
 
-//
+// Prints value in place, indenting lines of nested arrays and objects from given depth
 static void jvalue_print(const jvalue_t *restrict value,
-  const FILE *restrict file, size_t indent) {
+  FILE *restrict file, size_t indent) {
     switch (value->type) {
-    case J_BOOL:    indent_print(file, indent,
-                      value->value.boolean ? "true" : "false");         break;
-    case J_NUM:     jfloat_print(value->value.number, file);            break;
-    case J_STR:     indent_print(file, indent, value->value.string);    break;
-    case J_ARR:     jarray_print(value->value.array, file, indent);     break;
-    case J_OBJ:     json_print(value->value.object, file, indent);      break;
+    case J_BOOL:    fputs(value->value.boolean ? "true" : "false", file);  break;
+    case J_NUM:     jfloat_print(value->value.number, file);                break;
+    case J_STR:
+        jstring_write(value->value.string, strlen(value->value.string), file);
+        break;
+    case J_ARR:     jarray_print(value->value.array, file, indent);         break;
+    case J_OBJ:     jobject_print(value->value.object, file, indent);       break;
+    case J_NULL:    fputs("null", file);                                    break;
     }
 }
 
-//
+// Prints entries of tree in key order, each on its own line
 static bool jentry_print(const jentry_t *restrict root,
-  const FILE *restrict file, size_t indent) {
-    if (root->lchild) {
-        if (!jentry_print(root->lchild, file, indent))
-            return false;   // jentry_print() fails
+  FILE *restrict file, size_t indent) {
+    const jentry_t *next;
+
+    for (const jentry_t *entry = json_smallest(root); entry; entry = next) {
+        next = json_next(entry);
+        indent_print(file, indent, "");
+        jstring_write(entry->key, strlen(entry->key), file);
+        fputs(": ", file);
+        jvalue_print(entry->value, file, indent);
+        fputs(next ? ",\n" : "\n", file);
     }
-    if (root->rchild) {
-        if (!jentry_print(root->rchild, file, indent))
-            return false;
+    return true;
+}
+
+// Prints object without updating statistics
+static bool jobject_print(const json_t *restrict json,
+  FILE *restrict file, size_t indent) {
+    if (!json->root) {
+        fputs("{}", file);
+        return true;
     }
-    indent_print(file, indent, "\"%s\": ", root->key);
-    if (root->value->type & (J_ARR|J_OBJ))
-        fputs("\n", file);  // Use fputs(), as FILE param is restricted
-    jvalue_print(root->value, file, indent);
-    fputs(",\n", file);
+    fputs("{\n", file);
+    if (!jentry_print(json->root, file, indent + 1))
+        return false;   // jentry_print() fails
+    indent_print(file, indent, "}");
     return true;
 }
 
 bool json_print(const json_t *restrict json,
-  const FILE *restrict file, size_t indent) {
-    if (!file)
+  FILE *restrict file, size_t indent) {
+    if (!json || !file)
         error(EINVAL, false);
-    indent_print(file, indent, "{\n");
-    if (json->root) {
-        if (!jentry_print(json->root, file, indent + 1))
-            return false;   // jentry_print() fails
+
+    const uint64_t START = jstat_start();
+    const bool SUCCESS = jobject_print(json, file, indent) && fputc('\n', file) != EOF;
+
+    jstat_stop(print, START);
+    return SUCCESS;
+}
+
+bool jschema_compile(jschema_t *schema) {
+    if (!schema || (schema->count && !schema->fields))
+        error(EINVAL, false);
+    if (schema->count > JSCHEMA_MAXFIELDS)
+        error(E2BIG, false);
+
+    uint64_t hashes[JSCHEMA_MAXFIELDS];
+    size_t sizes[JSCHEMA_MAXFIELDS];
+    bool placed = false;
+
+    for (size_t i = 0; i < schema->count; ++i) {
+        const jfield_t *field = schema->fields + i;
+        const size_t SIZE = field->type == JF_BOOL  ? sizeof(bool)
+                          : field->type == JF_INT   ? sizeof(long long)
+                          : field->type == JF_NUM   ? sizeof(jfloat_t)
+                          : field->type == JF_STR   ? sizeof(char *)
+                          : field->type == JF_VALUE ? sizeof(jvalue_t *) : field->size;
+
+        if (!field->key || field->size != SIZE || !field->size ||
+          (field->type == JF_OBJ) != (field->schema != NULL))
+            error(EINVAL, false);   // Member does not match type of field
     }
-    indent_print(file, indent, "}\n");
+    schema->slots = 2;
+    while (schema->slots < schema->count * 2)
+        schema->slots *= 2;
+    schema->buckets = schema->count / 2 + 1;
+    for (schema->seed = 0; !placed && schema->seed < JSCHEMA_SEEDS; ++schema->seed) {
+        memset(schema->table, 0, sizeof(schema->table));
+        memset(sizes, 0, schema->buckets * sizeof(size_t));
+        for (size_t i = 0; i < schema->count; ++i) {
+            const char *KEY = schema->fields[i].key;
+
+            hashes[i] = jschema_hash(schema, KEY, strlen(KEY));
+            ++sizes[jschema_bucket(schema, hashes[i])];
+        }
+        placed = true;
+        for (size_t size = schema->count; placed && size; --size) {  // Largest buckets first
+            for (size_t bucket = 0; placed && bucket < schema->buckets; ++bucket) {
+                if (sizes[bucket] == size)
+                    placed = jschema_place(schema, bucket, hashes);
+            }
+        }
+    }
+    if (!placed) {  // Keys of two fields are likely equal
+        schema->slots = 0;
+        error(EINVAL, false);
+    }
+    --schema->seed;
     return true;
 }
+bool json_validate(const char *string, size_t len, size_t *offset) {
+    if (!string)
+        error(EINVAL, false);
 
-bool json_remove(json_t *json, const char *key) {
-    if (!json || !key)
+    jscanner_t scanner = {string, string + len};
+
+    if (jvalidate_document(&scanner))
+        return true;
+    if (offset)
+        *offset = scanner.pos - string;
+    return false;
+}
+bool jschema_decode(jschema_t *schema, const char *string, size_t len, void *object) {
+    if (!schema || !string || !object)
         error(EINVAL, false);
-    if (!json->root)   // Entry doesn't exist
-        error(ENOENT, false);
 
-    jinfo_t *info = json_seek(json->root, key, false);
+    jscanner_t scanner = {string, string + len};
+    const size_t OBJECTS = jschema_objects(schema);
+    uint64_t buffer[JSCHEMA_SEENBUF];
+    uint64_t *seen = OBJECTS <= JSCHEMA_SEENBUF ? buffer : malloc(OBJECTS * sizeof(uint64_t));
+    bool success;
 
-    if (!info)   // json_seek() fails
-       return false;
-    
-    jentry_t *tmp, *target = info->target;
+    if (!seen)  // malloc() fails
+        return false;
+    memset(seen, 0, OBJECTS * sizeof(uint64_t));
+    success = jschema_decode_object(schema, &scanner, object, 1, seen);
+    if (!success) {     // Free only what the decoder allocated, at every depth
+        const int ERRNO = errno;
+
+        jschema_free_fields(schema, object, seen);
+        errno = ERRNO;
+    }
+    if (seen != buffer)
+        free(seen);
+    return success;
+}
+bool jschema_encode(jschema_t *schema, const void *object, FILE *file) {
+    if (!schema || !object || !file)
+        error(EINVAL, false);
+    jschema_encode_object(schema, object, file);
+    return !ferror(file);
+}
+
+// Removes entry from the tree of a JSON object, failing if it is NULL
+static bool json_unlink(json_t *json, jentry_t *target) {
+    jentry_t *child;
 
     if (!target)   // Entry not found
         error(ENOENT, false);
-    
-    const bool IS_LCHILD = target == target->parent->lchild;
+    jnode_invalidate(&json->node);
+    --json->size;
+    if (target->lchild && target->rchild) {     // Remove in-order successor instead
+        jentry_t *successor = json_smallest(target->rchild);
+        char *key_tmp = target->key;
+        jvalue_t *value_tmp = target->value;
 
-    if (target->lchild) {
-        if (IS_LCHILD) {
-            tmp = json_smallest(target->rchild);
-            target->parent->lchild = tmp;
-        } else {
-            tmp = json_largest(target->rchild);
-            target->parent->rchild = tmp;
-        }
-        tmp->rchild = target->rchild;
-        tmp->parent = target->parent;
-    } else if (target->rchild) {
-        if (IS_LCHILD) {
-            tmp = json_largest(target->rchild);
-            target->parent->lchild = tmp;
-        } else {
-            tmp = json_smallest(target->rchild);
-            target->parent->rchild = tmp;
-        }
-        tmp->lchild = target->lchild;
-        tmp->parent = target->parent;
-    } else {
-        if (IS_LCHILD)  target->parent->lchild = NULL;
-        else            target->parent->rchild = NULL;
+        target->key = successor->key;
+        target->value = successor->value;
+        successor->key = key_tmp;
+        successor->value = value_tmp;
+        target = successor;
     }
+    child = target->lchild ? target->lchild : target->rchild;
+    if (child)
+        child->parent = target->parent;
+    if (!target->parent)
+        json->root = child;
+    else {
+        if (target == target->parent->lchild)   target->parent->lchild = child;
+        else                                    target->parent->rchild = child;
+        json->root = json_balance(target->parent);
+    }
+    jstat_free(strings, strlen(target->key) + 1);
+    jstat_free(entries, sizeof(jentry_t));
     free(target->key);
     jvalue_free(target->value);
     free(target);
-    json_balance(json->root);
+    return true;
+}
+bool json_remove(json_t *json, const char *key) {
+    if (!json || !key)
+        error(EINVAL, false);
+    return json_unlink(json, json_seek(json->root, key).target);
+}
+bool json_remove_len(json_t *json, const char *key, size_t len) {
+    if (!json || !key)
+        error(EINVAL, false);
+    return json_unlink(json, json_seek_len(json->root, key, len).target);
+}
+bool jshared_publish(jshared_t *shared, json_t *json) {
+    if (!shared)
+        error(EINVAL, false);
+
+    jretired_t *retired = malloc(sizeof(jretired_t));
+
+    if (!retired)   // malloc() fails
+        return false;
+    retired->json = atomic_exchange(&shared->current, json);
+    if (!retired->json) {   // Nothing to reclaim
+        free(retired);
+        return true;
+    }
+    retired->epoch = atomic_fetch_add(&shared->epoch, 1);
+    jshared_retire(shared, retired, retired);
+    return true;
+}
+bool json_merge(json_t *dst, const json_t *src) {
+    if (!dst || !src)
+        error(EINVAL, false);
+    if (dst == src) {   // Merging object into itself only removes nulls
+        json_t *copy = json_copy(src);
+        bool success;
+
+        if (!copy)  // json_copy() fails
+            return false;
+        success = json_merge_entries(dst, copy, true);
+        json_free(copy);
+        return success;
+    }
+    return json_merge_entries(dst, (json_t *) src, false);
+}
+bool json_merge_move(json_t *dst, json_t *src) {
+    if (!src || dst == src)     // Nothing that may be freed
+        error(EINVAL, false);
+    if (!dst) {
+        json_free(src);
+        error(EINVAL, false);
+    }
+
+    const bool SUCCESS = json_merge_entries(dst, src, true);
+
+    json_free(src);
+    return SUCCESS;
+}
+bool json_patch_apply(json_t *json, const jarray_t *patch) {
+    if (!json || !patch)
+        error(EINVAL, false);
+    for (size_t i = 0; i < patch->size; ++i) {
+        if (!jpatch_apply_op(json, patch->values[i]))
+            return false;
+    }
     return true;
 }
 bool jvalue_modify(jvalue_t *restrict value, const jvalue_t *restrict NEW_VALUE) {
     if (!value || !NEW_VALUE)
         error(EINVAL, false);
-    switch (value->type = NEW_VALUE->type) {
-    case J_STR: value->value.string = strdup(NEW_VALUE->value.string);      break;
-    case J_ARR: value->value.array  = jarray_copy(NEW_VALUE->value.array);   break;
-    case J_OBJ: value->value.object = json_copy(NEW_VALUE->value.object);    break;
-    default:    value->value = NEW_VALUE->value;
+
+    jvalue_t *new_value = jvalue_copy(NEW_VALUE);
+
+    if (!new_value) // jvalue_copy() fails
+        return false;
+    switch (value->type) {  // Free previous contents
+    case J_STR: jstat_free(strings, strlen(value->value.string) + 1);
+                free(value->value.string);          break;
+    case J_ARR: jarray_free(value->value.array);    break;
+    case J_OBJ: json_free(value->value.object);
+    }
+    value->type = new_value->type;
+    value->value = new_value->value;
+    jstat_free(values, sizeof(jvalue_t));
+    free(new_value);
+    jvalue_attach(value, value->parent);
+    jnode_invalidate(value->parent);
+    return true;
+}
+bool json_equal(const json_t *json1, const json_t *json2) {
+    if (!json1 || !json2)
+        error(EINVAL, false);
+    if (json1 == json2)
+        return true;
+    if (json1->size != json2->size || jnode_differ(json1->node, json2->node))
+        return false;
+    return json_equal_members(json1, json2);
+}
+bool jvalue_equal(const jvalue_t *value1, const jvalue_t *value2) {
+    if (!value1 || !value2)
+        error(EINVAL, false);
+    if (value1 == value2)
+        return true;
+    if (value1->type != value2->type)
+        return false;
+    switch (value1->type) {
+    case J_BOOL:    return value1->value.boolean == value2->value.boolean;
+    case J_NUM:     return value1->value.number == value2->value.number;
+    case J_STR:     return !strcmp(value1->value.string, value2->value.string);
+    case J_OBJ:     return json_equal(value1->value.object, value2->value.object);
+    case J_NULL:    return true;
+    }
+
+    const jarray_t *ARRAY1 = value1->value.array, *ARRAY2 = value2->value.array;
+
+    if (ARRAY1 == ARRAY2)
+        return true;
+    if (ARRAY1->size != ARRAY2->size || jnode_differ(ARRAY1->node, ARRAY2->node))
+        return false;
+    for (size_t i = 0; i < ARRAY1->size; ++i) {
+        if (!jvalue_equal(ARRAY1->values[i], ARRAY2->values[i]))
+            return false;
     }
     return true;
 }
@@ -528,13 +3004,152 @@ int jvalue_cmp(const jvalue_t *value1, const jvalue_t *value2) {
 size_t json_size(const json_t *restrict json) {
     if (!json)
         error(EINVAL, 0);
-    return json->root ? json->root->height : 0;
+    return json->size;
+}
+size_t json_hash(const json_t *json) {
+    if (!json)
+        error(EINVAL, 0);
+    return json_structhash(json, NULL);
+}
+size_t jvalue_hash(const jvalue_t *value) {
+    if (!value)
+        error(EINVAL, 0);
+    return jvalue_structhash(value, NULL);
+}
+
+size_t jshared_reclaim(jshared_t *shared) {
+    if (!shared)
+        error(EINVAL, 0);
+
+    jretired_t *retired = atomic_exchange(&shared->retired, NULL), *next;
+    jretired_t *kept_head = NULL, *kept_tail = NULL;
+    uint64_t oldest = UINT64_MAX;
+    size_t count = 0;
+
+    for (jreader_t *reader = atomic_load(&shared->readers);
+      reader; reader = reader->next) {  // Find oldest epoch still being read
+        const uint64_t EPOCH = atomic_load(&reader->epoch);
+
+        if (EPOCH && EPOCH < oldest)
+            oldest = EPOCH;
+    }
+    for (; retired; retired = next) {
+        next = retired->next;
+        if (retired->epoch < oldest) {  // No reader can hold this version
+            json_free(retired->json);
+            free(retired);
+            ++count;
+        } else {
+            retired->next = kept_head;
+            kept_head = retired;
+            if (!kept_tail)
+                kept_tail = retired;
+        }
+    }
+    if (kept_head)
+        jshared_retire(shared, kept_head, kept_tail);
+    return count;
+}
+
+// Adds bytes held by entry tree to usage, returning total
+static size_t jentry_memory_usage(const jentry_t *root, jmemory_t *usage) {
+    size_t total = 0;
+
+    for (const jentry_t *entry = json_smallest(root); entry; entry = json_next(entry)) {
+        const size_t KEY = strlen(entry->key) + 1;
+
+        usage->entries += sizeof(jentry_t);
+        usage->strings += KEY;
+        total += sizeof(jentry_t) + KEY + jvalue_memory_usage(entry->value, usage);
+    }
+    return total;
+}
+
+size_t jvalue_memory_usage(const jvalue_t *value, jmemory_t *usage) {
+    jmemory_t discard;
+    size_t total = sizeof(jvalue_t), size;
+
+    if (!value)
+        error(EINVAL, 0);
+    if (!usage) {
+        memset(&discard, 0, sizeof(jmemory_t));
+        usage = &discard;
+    }
+    usage->values += sizeof(jvalue_t);
+    switch (value->type) {
+    case J_STR:
+        size = strlen(value->value.string) + 1;
+        usage->strings += size;
+        total += size;
+        break;
+    case J_ARR:
+        size = sizeof(jarray_t) + value->value.array->capacity * sizeof(jvalue_t *);
+        usage->arrays += size;
+        total += size;
+        for (size_t i = 0; i < value->value.array->size; ++i)
+            total += jvalue_memory_usage(value->value.array->values[i], usage);
+        break;
+    case J_OBJ:
+        usage->objects += sizeof(json_t);
+        total += sizeof(json_t);
+        if (value->value.object->root)
+            total += jentry_memory_usage(value->value.object->root, usage);
+    }
+    return total;
+}
+jstats_t json_stats(void) {
+#ifdef JSON_STATS
+    return jstats;
+#else
+    const jstats_t EMPTY = {0};
+
+    return EMPTY;
+#endif
+}
+void json_stats_reset(void) {
+#ifdef JSON_STATS
+    const jmemory_t HELD = jstats.held;
+
+    memset(&jstats, 0, sizeof(jstats_t));
+    jstats.held = HELD;
+#endif
+}
+jcursor_t json_cursor(const json_t *json) {
+    return json_range(json, NULL, NULL);
+}
+jcursor_t json_range(const json_t *json, const char *lo, const char *hi) {
+    jcursor_t cursor = {NULL, NULL};
+
+    if (!json) {
+        errno = EINVAL;
+        return cursor;
+    }
+    if (lo && hi && strcmp(lo, hi) >= 0)    // Empty range
+        return cursor;
+    cursor.entry = !json->root ? NULL :
+      lo ? json_bound(json->root, lo, strlen(lo), false) : json_smallest(json->root);
+    cursor.end = hi ? json_bound(json->root, hi, strlen(hi), false) : NULL;
+    return cursor;
+}
+jcursor_t json_prefix(const json_t *json, const char *prefix) {
+    jcursor_t cursor = {NULL, NULL};
+
+    if (!json || !prefix) {
+        errno = EINVAL;
+        return cursor;
+    }
+
+    const size_t LEN = strlen(prefix);
+
+    cursor.entry = json_bound(json->root, prefix, LEN, false);
+    cursor.end = json_bound(json->root, prefix, LEN, true);
+    return cursor;
 }
 jarray_t *jarray_copy(const jarray_t *restrict array) {
     if (!array)
         error(EINVAL, NULL);
 
-    jarray_t *restrict new_array = malloc(sizeof(json_t));
+    jarray_t *restrict new_array = malloc(sizeof(jarray_t));
 
     if (!new_array)    // malloc() fails
         return NULL;
@@ -543,20 +3158,63 @@ jarray_t *jarray_copy(const jarray_t *restrict array) {
         free(new_array);
         return NULL;
     }
+    jstat_alloc(arrays, sizeof(jarray_t) + array->capacity * sizeof(jvalue_t *));
     new_array->size = array->size;
     new_array->capacity = array->capacity;
-    for (size_t i = 0; i < array->size; ++i)
+    new_array->node.hash = array->node.hash;    // Structure is identical
+    new_array->node.parent = NULL;
+    for (size_t i = 0; i < array->size; ++i) {
         new_array->values[i] = jvalue_copy(array->values[i]);
-    return true;
+        if (!new_array->values[i]) {
+            new_array->size = i;
+            jarray_free(new_array);
+            return NULL;
+        }   // jvalue_copy() fails
+        jvalue_attach(new_array->values[i], &new_array->node);
+    }
+    return new_array;
 }
 jarray_t *jarray_new(void) {
     jarray_t *new_array = malloc(sizeof(jarray_t));
 
+    if (!new_array)    // malloc() fails
+        return NULL;
+    new_array->values = malloc(JARRAY_DEFCAP * sizeof(jvalue_t *));
+    if (!new_array->values) {
+        free(new_array);
+        return NULL;
+    }
+    jstat_alloc(arrays, sizeof(jarray_t) + JARRAY_DEFCAP * sizeof(jvalue_t *));
     new_array->size = 0;
     new_array->capacity = JARRAY_DEFCAP;
-    new_array->values = malloc(JARRAY_DEFCAP * sizeof(jvalue_t *));
+    new_array->node.hash = 0;
+    new_array->node.parent = NULL;
     return new_array;
 }
+jarray_t *json_diff(const json_t *json1, const json_t *json2) {
+    if (!json1 || !json2)
+        error(EINVAL, NULL);
+
+    jarray_t *patch = jarray_new();
+    jpath_t path = {calloc(1, 1), 0, 1};
+    jhashes_t hashes = {NULL, 0, 0};
+
+    if (!patch || !path.data) {
+        if (patch)
+            jarray_free(patch);
+        free(path.data);
+        return NULL;
+    }   // jarray_new() fails || calloc() fails
+    json_structhash(json1, &hashes);    // Hash into side table, leaving inputs unmodified,
+    json_structhash(json2, &hashes);    // so that unequal subtrees are rejected early
+    if (!jdiff_object(patch, &path, &hashes, json1, json2)) {
+        jarray_free(patch);
+        patch = NULL;
+    }
+    free(hashes.slots);
+    free(path.data);
+    return patch;
+}
 json_t *json_copy(const json_t *restrict json) {
     if (!json)
         error(EINVAL, NULL);
@@ -565,21 +3223,89 @@ json_t *json_copy(const json_t *restrict json) {
 
     if (!new_json) // malloc() fails
         return NULL;
+    new_json->size = json->size;
+    new_json->node.hash = json->node.hash;  // Structure is identical
+    new_json->node.parent = NULL;
     if (json->root) {
-        new_json->root = jentry_new(NULL, json->root->key, json->root->value);
-        if (!new_json->root || !json_build(new_json->root, json->root)) {
+        new_json->root = jentry_new(new_json, NULL, json->root->key, json->root->value);
+        if (!new_json->root || !json_build(new_json, new_json->root, json->root)) {
+            if (new_json->root)
+                jentry_free(new_json->root);
             free(new_json);
             return NULL;
         }   // jentry_new() fails || json_build() fails
     } else
         new_json->root = NULL;
-    return true;
+    jstat_alloc(objects, sizeof(json_t));
+    return new_json;
+}
+json_t *json_new(void) {
+    json_t *new_json = calloc(1, sizeof(json_t));
+
+    if (new_json)
+        jstat_alloc(objects, sizeof(json_t));
+    return new_json;
 }
-json_t *json_new(void) { return calloc(1, sizeof(json_t)); }
-json_t *json_parse(const FILE *file) { //TODO
+json_t *json_parse(FILE *file) {
     if (!file)
         error(EINVAL, NULL);
-    
+
+    const uint64_t START = jstat_start();
+    json_t *json = NULL;
+    size_t len;
+    char *buffer = jfile_read(file, &len);
+
+    if (buffer) {
+        jscanner_t scanner = {buffer, buffer + len};
+
+        json = jparse_document(&scanner);
+        free(buffer);
+    }   // jfile_read() succeeds
+    jstat_stop(parse, START);
+    return json;
+}
+const json_t *jshared_enter(jreader_t *reader) {
+    if (!reader)
+        error(EINVAL, NULL);
+
+    jshared_t *shared = reader->shared;
+
+    atomic_store(&reader->epoch, atomic_load(&shared->epoch));
+    return atomic_load(&shared->current);
+}
+jreader_t *jshared_register(jshared_t *shared) {
+    if (!shared)
+        error(EINVAL, NULL);
+
+    jreader_t *reader;
+
+    for (reader = atomic_load(&shared->readers); reader; reader = reader->next) {
+        bool inactive = false;
+
+        if (atomic_compare_exchange_strong(&reader->active, &inactive, true))
+            return reader;  // Reuse released reader
+    }
+    reader = malloc(sizeof(jreader_t));
+    if (!reader)    // malloc() fails
+        return NULL;
+    atomic_init(&reader->epoch, 0);
+    atomic_init(&reader->active, true);
+    reader->shared = shared;
+    reader->next = atomic_load(&shared->readers);
+    while (!atomic_compare_exchange_weak(&shared->readers, &reader->next, reader))
+        ;
+    return reader;
+}
+jshared_t *jshared_new(json_t *json) {
+    jshared_t *new_shared = malloc(sizeof(jshared_t));
+
+    if (!new_shared)    // malloc() fails
+        return NULL;
+    atomic_init(&new_shared->current, json);
+    atomic_init(&new_shared->epoch, 1);
+    atomic_init(&new_shared->readers, NULL);
+    atomic_init(&new_shared->retired, NULL);
+    return new_shared;
 }
 jvalue_t *jarray_findf(jarray_t *restrict array, const jvalue_t *value) {
     if (!array || !value)
@@ -637,6 +3363,8 @@ jvalue_t *jarray_popf(jarray_t *restrict array) {
 
     jvalue_t *value = array->values[0];
 
+    jnode_invalidate(&array->node);
+    jvalue_attach(value, NULL);
     --array->size;
     for (size_t i = 0; i < array->size; ++i)    // Shift members forward
         array->values[i] = array->values[i + 1];
@@ -651,6 +3379,8 @@ jvalue_t *jarray_popb(jarray_t *restrict array) {
 
     jvalue_t *value = array->values[array->size - 1];
 
+    jnode_invalidate(&array->node);
+    jvalue_attach(value, NULL);
     --array->size;
     array->values[array->size] = NULL;
     return value;
@@ -658,7 +3388,18 @@ jvalue_t *jarray_popb(jarray_t *restrict array) {
 jvalue_t *json_find(const json_t *restrict json, const char *key) {
     if (!json || !key)
         error(EINVAL, NULL);
-    return json_seek(json->root, key, false)->target;
+
+    const jentry_t *target = json_seek(json->root, key).target;
+
+    return target ? target->value : NULL;
+}
+jvalue_t *json_find_len(const json_t *json, const char *key, size_t len) {
+    if (!json || !key)
+        error(EINVAL, NULL);
+
+    const jentry_t *target = json_seek_len(json->root, key, len).target;
+
+    return target ? target->value : NULL;
 }
 jvalue_t *jvalue_copy(const jvalue_t *restrict value) {
     if (!value)
@@ -668,7 +3409,9 @@ jvalue_t *jvalue_copy(const jvalue_t *restrict value) {
 
     if (!new_value)    // malloc() fails
         return NULL;
+    jstat_alloc(values, sizeof(jvalue_t));
     new_value->type = value->type;
+    new_value->parent = NULL;
     switch (value->type) {
     case J_BOOL:    new_value->value.boolean = value->value.boolean;            break;
     case J_NUM:     new_value->value.number  = value->value.number;             break;
@@ -676,12 +3419,63 @@ jvalue_t *jvalue_copy(const jvalue_t *restrict value) {
     case J_ARR:     new_value->value.array   = jarray_copy(value->value.array); break;
     case J_OBJ:     new_value->value.object  = json_copy(value->value.object);
     }
+    if ((value->type == J_STR && !new_value->value.string) ||
+      (value->type == J_ARR && !new_value->value.array) ||
+      (value->type == J_OBJ && !new_value->value.object)) {
+        jstat_free(values, sizeof(jvalue_t));
+        free(new_value);
+        return NULL;
+    }   // strdup() fails || jarray_copy() fails || json_copy() fails
+    if (value->type == J_STR)
+        jstat_alloc(strings, strlen(value->value.string) + 1);
     return new_value;
 }
 
 jvalue_t *jvalue_new(char type, const jany_t value) {
-    if (!(type & (J_BOOL|J_NUM|J_STR|J_ARR|J_OBJ)) ||  // Invalid type ||
-      type & (J_STR|J_ARR|J_OBJ) && !value.object)              // Passed NULL pointer
+    if (type < J_BOOL || type > J_NULL ||                   // Invalid type ||
+      ((type == J_STR || type == J_ARR || type == J_OBJ) && !value.object))   // Passed NULL pointer
         error(EINVAL, NULL);
-    
-}
\ No newline at end of file
+
+    jvalue_t *new_value = malloc(sizeof(jvalue_t));
+
+    if (!new_value)    // malloc() fails
+        return NULL;
+    jstat_alloc(values, sizeof(jvalue_t));
+    if (type == J_STR)  // String is now held by this library
+        jstat_alloc(strings, strlen(value.string) + 1);
+    new_value->type = type;
+    new_value->value = value;
+    jvalue_attach(new_value, NULL);
+    return new_value;
+}
+jvalue_t *jentry_value(const jentry_t *entry) {
+    if (!entry)
+        error(EINVAL, NULL);
+    return entry->value;
+}
+jentry_t *json_first(const json_t *json) {
+    if (!json)
+        error(EINVAL, NULL);
+    return json->root ? json_smallest(json->root) : NULL;
+}
+jentry_t *jentry_next(const jentry_t *entry) {
+    if (!entry)
+        error(EINVAL, NULL);
+    return json_next(entry);
+}
+const char *jentry_key(const jentry_t *entry) {
+    if (!entry)
+        error(EINVAL, NULL);
+    return entry->key;
+}
+jentry_t *jcursor_next(jcursor_t *cursor) {
+    if (!cursor)
+        error(EINVAL, NULL);
+
+    jentry_t *entry = cursor->entry;
+
+    if (entry == cursor->end)   // Exhausted
+        return NULL;
+    cursor->entry = json_next(entry);
+    return entry;
+}
@@ -2,6 +2,7 @@
 #define LADLE_JSON_H
 #include <float.h>          // floating-point constants
 #include <stddef.h>         // size_t
+#include <stdint.h>         // uint64_t
 #include <stdio.h>          // FILE
 #ifndef __cplusplus
 #include <stdbool.h>    // bool
@@ -9,6 +10,10 @@
 
 #include <ladle/common/defs.h>
 
+#ifdef __cplusplus
+extern "C" {
+#endif
+
 // Ensures parsing of .json files does not result in precision loss
 #if DBL_DIG < 15
 #if LDBL_DIG < 15
@@ -65,13 +70,29 @@ typedef double jfloat_t;
 // Capacity of newly-allocated jarray_t
 #define JARRAY_DEFCAP  8
 
+// Most pairs of array members aligned by json_diff() before comparing by position
+#define JDIFF_LCSMAX    (1 << 20)
+
+// Deepest nesting of arrays and objects accepted when parsing
+#define JSON_MAXDEPTH   1024
+
+// Most fields described by a single schema
+#define JSCHEMA_MAXFIELDS   64
+
 // Used to tell what type a JSON entry is
-typedef enum jtype_t {J_BOOL, J_NUM, J_STR, J_ARR, J_OBJ} jtype_t;
+typedef enum jtype_t {J_BOOL, J_NUM, J_STR, J_ARR, J_OBJ, J_NULL} jtype_t;
+
+// State shared by JSON arrays and objects
+typedef struct jnode_t {
+    size_t hash;                // Cached structural hash, or 0 if not computed
+    struct jnode_t *parent;     // Array or object holding this one, if any
+} jnode_t;
 
 // JSON array
 typedef struct jarray_t {
     size_t size, capacity;
     struct jvalue_t **values;
+    jnode_t node;
 } jarray_t;
 
 // JSON value
@@ -83,89 +104,386 @@ typedef union jany_t {
     struct json_t *object;
 } jany_t;
 
+// Entry of a JSON object, holding a key and its value
+typedef struct jentry_t jentry_t;
+
+/* Position within a run of entries of a JSON object, visited in key order
+ * Cursors hold no memory, and move between entries through parent pointers.
+ * A cursor is invalidated when an entry is added to or removed from its object. */
+typedef struct jcursor_t {
+    jentry_t *entry;    // Next entry to visit, or NULL once exhausted
+    jentry_t *end;      // First entry past the run, or NULL if it reaches the last
+} jcursor_t;
+
 // JSON object
 typedef struct json_t {
     struct jentry_t *root;
+    size_t size;    // Number of entries
+    jnode_t node;
 } json_t;
 
 // JSON value
 typedef struct jvalue_t {
     char type;
     union jany_t value;
+    jnode_t *parent;    // Array or object holding this value, if any
 } jvalue_t;
 
+/* Atomically replaceable JSON object, shared between threads
+ * Readers never block: a new version is published by swapping a pointer,
+ * and replaced versions are freed once no reader can still observe them. */
+typedef struct jshared_t jshared_t;
+
+// Reader of a shared JSON object, used by one thread at a time
+typedef struct jreader_t jreader_t;
+
+// Bytes held by each kind of node
+typedef struct jmemory_t {
+    size_t entries;     // jentry_t
+    size_t values;      // jvalue_t
+    size_t strings;     // Keys and string values
+    size_t arrays;      // jarray_t and its storage
+    size_t objects;     // json_t
+} jmemory_t;
+
+/* Library-wide counters
+ * Only collected when json.c is compiled with JSON_STATS defined;
+ * otherwise, every counter remains zero.
+ * Counters are not synchronized and should be read while the library is idle;
+ * builds with JSON_STATS are not suitable for concurrent readers. */
+typedef struct jstats_t {
+    size_t allocs, frees;           // Calls to allocator; realloc() counts as both
+    jmemory_t held;                 // Bytes currently held
+    size_t rotations;               // Tree rotations during rebalancing
+    size_t comparisons;             // Key comparisons during lookup
+    size_t parses, prints;          // Calls to json_parse() and json_print()
+    uint64_t parse_ns, print_ns;    // Time spent in json_parse() and json_print()
+} jstats_t;
+
+// Type of struct member described by a schema field
+typedef enum jftype_t {
+    JF_BOOL,    // bool
+    JF_INT,     // long long, from an integral number
+    JF_NUM,     // jfloat_t
+    JF_STR,     // char *, allocated by decoder, or NULL if null
+    JF_CHARS,   // char[], holding a NUL-terminated string
+    JF_OBJ,     // struct, described by a nested schema
+    JF_VALUE    // jvalue_t *, holding any JSON value, allocated by decoder
+} jftype_t;
+
+// Member of a C struct, decoded from and encoded to a key of a JSON object
+typedef struct jfield_t {
+    const char *key;
+    jftype_t type;
+    size_t offset, size;        // Position and size of member within struct
+    struct jschema_t *schema;   // Schema of JF_OBJ member
+    bool required;              // Decoding fails if key is absent
+} jfield_t;
+
+/* Mapping between a C struct and JSON objects
+ * Keys are dispatched to fields through a perfect hash table, built by
+ * jschema_compile() or on first use. Schemas shared between threads
+ * must be compiled beforehand. */
+typedef struct jschema_t {
+    const jfield_t *fields;
+    size_t count;
+    uint64_t seed;                          // Seed of key hash
+    size_t buckets, slots;                  // 0 until compiled
+    uint16_t displace[JSCHEMA_MAXFIELDS];   // Displacement of each bucket
+    unsigned char table[2 * JSCHEMA_MAXFIELDS]; // Index of field + 1, or 0 if empty
+} jschema_t;
+
+// Describes member of struct, stored under the key of the same name
+#define JFIELD(type, member, ftype) \
+    JFIELD_KEY(#member, type, member, ftype)
+
+// Describes member of struct, stored under the given key
+#define JFIELD_KEY(key, type, member, ftype) \
+    {key, ftype, offsetof(type, member), sizeof(((type *) 0)->member), NULL, false}
+
+// Describes member of struct that must be present when decoding
+#define JFIELD_REQ(type, member, ftype) \
+    {#member, ftype, offsetof(type, member), sizeof(((type *) 0)->member), NULL, true}
+
+// Describes nested struct, mapped by the schema defined by JSCHEMA(name, ...)
+#define JFIELD_OBJ(type, member, name) \
+    {#member, JF_OBJ, offsetof(type, member), \
+    sizeof(((type *) 0)->member), &name##_schema, false}
+
+/* Defines a schema named 'name##_schema' for the given struct and fields,
+ * along with functions specialised to it:
+ *
+ *     bool name##_decode(const char *string, size_t len, type *object);
+ *     bool name##_encode(const type *object, FILE *file);
+ *     void name##_free(type *object);
+ */
+#define JSCHEMA(name, type, ...)                                            \
+    static const jfield_t name##_fields[] = {__VA_ARGS__};                 \
+    static jschema_t name##_schema =                                        \
+      {name##_fields, sizeof(name##_fields) / sizeof(jfield_t),             \
+      0, 0, 0, {0}, {0}};                                                   \
+    static inline bool name##_decode(const char *string,                    \
+      size_t len, type *object) {                                           \
+        return jschema_decode(&name##_schema, string, len, object);         \
+    }                                                                       \
+    static inline bool name##_encode(const type *object, FILE *file) {      \
+        return jschema_encode(&name##_schema, object, file);                \
+    }                                                                       \
+    static inline void name##_free(type *object) {                          \
+        jschema_free(&name##_schema, object);                               \
+    }
+
 // Frees memory held within a JSON array
 void jarray_free(jarray_t *array)
-attribute(nonnull, nothrow);
+attribute(nothrow);
 
 // Frees memory held within a JSON object
 void json_free(json_t *json)
-attribute(nonnull, nothrow);
+attribute(nothrow);
 
 // Frees memory held within a JSON value
 void jvalue_free(jvalue_t *value)
+attribute(nothrow);
+
+/* Frees a shared JSON object, including every version not yet reclaimed
+ * No reader may be within a read section */
+void jshared_free(jshared_t *shared)
+attribute(nothrow);
+
+// Ends a read section, after which the object returned by jshared_enter() may be freed
+void jshared_leave(jreader_t *reader)
 attribute(nonnull, nothrow);
 
+// Releases a reader for reuse by a later call to jshared_register()
+void jshared_unregister(jreader_t *reader)
+attribute(nothrow);
+
+/* Frees strings and values allocated within a struct by jschema_decode()
+ * Freed pointers are set to NULL */
+void jschema_free(const jschema_t *schema, void *object)
+attribute(nothrow);
+
 bool jarray_pushb(jarray_t *array, const jvalue_t *restrict value)
-attribute(nonnull, nothrow);
+attribute(nothrow);
 
 bool jarray_pushf(jarray_t *array, const jvalue_t *restrict value)
-attribute(nonnull, nothrow);
+attribute(nothrow);
+
+/* Appends a value to a JSON array, taking ownership of it
+ * The value must not be held by another array or object.
+ * Returns true on normal operation
+ * Returns false and sets errno accordingly on error, in which case the value is freed */
+bool jarray_pushb_move(jarray_t *array, jvalue_t *value)
+attribute(nothrow);
 
 bool jarray_remove(jarray_t *restrict array, size_t index)
-attribute(nonnull, nothrow);
+attribute(nothrow);
 
 bool jarray_sort(jarray_t *restrict array)
-attribute(nonnull, nothrow);
+attribute(nothrow);
 
 /* Adds a value to a JSON object
  * Returns true on normal operation
  * Returns false and sets errno accordingly on error */
 bool json_add(json_t *json, const char *key, const jvalue_t *value)
-attribute(nonnull, nothrow);
+attribute(nothrow);
 
-bool json_print(const json_t *json, const FILE *file, size_t indent)
-attribute(nonnull, nothrow);
+/* Adds a value to a JSON object under a key of given length, taking ownership of the value
+ * The key need not be NUL-terminated, and the value must not be held by
+ * another array or object.
+ * Returns true on normal operation
+ * Returns false and sets errno accordingly on error, in which case the value is freed */
+bool json_add_move(json_t *json, const char *key, size_t len, jvalue_t *value)
+attribute(nothrow);
+
+/* Returns true if both JSON objects hold the same keys and equal values
+ * Numbers are compared exactly. Cached hashes are used to reject unequal
+ * objects early, and to skip comparison of differing subtrees. */
+bool json_equal(const json_t *json1, const json_t *json2)
+attribute(nothrow);
+
+/* Merges a JSON object into another, as an RFC 7386 JSON Merge Patch
+ * Members of src that are null remove those of dst, nested objects are
+ * merged recursively, and any other member of src replaces that of dst.
+ * Both objects are walked once in key order, taking O(n + m) time.
+ * Returns true on normal operation
+ * Returns false and sets errno accordingly on error,
+ * in which case dst holds a part of the merge */
+bool json_merge(json_t *dst, const json_t *src)
+attribute(nothrow);
+
+/* Merges a JSON object into another, as json_merge(), then frees src
+ * Values are moved out of src rather than copied.
+ * src is freed even if an error occurs, unless it is the same object as
+ * dst, in which case nothing is freed and errno is set to EINVAL */
+bool json_merge_move(json_t *dst, json_t *src)
+attribute(nothrow);
+
+/* Applies an RFC 6902 JSON Patch to a JSON object, in place
+ * Operations are applied in order; if one fails, those before it remain applied.
+ * Returns true on normal operation
+ * Returns false and sets errno accordingly on error,
+ * or to ECANCELED if a "test" operation fails */
+bool json_patch_apply(json_t *json, const jarray_t *patch)
+attribute(nothrow);
+
+/* Prints JSON object to file, indenting nested lines from given depth
+ * Keys and strings are escaped as required by RFC 8259
+ * Returns false and sets errno accordingly on error */
+bool json_print(const json_t *json, FILE *file, size_t indent)
+attribute(nothrow);
+
+/* Checks that a buffer holds a single well-formed JSON value, as described by
+ * RFC 8259, without constructing it
+ * Strings must be valid UTF-8, surrogates escaped by \u must be paired,
+ * and nesting may not exceed JSON_MAXDEPTH. Strings are scanned 16 bytes at a
+ * time where SSE2 is available; everything else, a byte at a time. Unlike json_parse(), the value need not be
+ * an object, and may hold U+0000 or numbers out of range of jfloat_t.
+ * Returns true if the buffer is valid
+ * Returns false and sets errno to EILSEQ if it is not, in which case
+ * 'offset', if not NULL, receives the position of the offending byte */
+bool json_validate(const char *string, size_t len, size_t *offset)
+attribute(nothrow);
+
+/* Builds perfect hash table of a schema, dispatching keys to fields
+ * Returns true on normal operation
+ * Returns false and sets errno to E2BIG if there are too many fields,
+ * or to EINVAL if two fields share a key */
+bool jschema_compile(jschema_t *schema)
+attribute(nothrow);
+
+/* Decodes a JSON object directly into a C struct, without building a JSON object
+ * Members whose keys are absent are left unchanged, and unknown keys are skipped.
+ * Returns true on normal operation
+ * Returns false and sets errno accordingly on error, to EILSEQ if the
+ * input is malformed or does not match the schema, or to ERANGE if a
+ * number or string does not fit its member; members allocated by the
+ * decoder, at any depth, are then freed and set to NULL. Other members
+ * decoded before the error hold their new values, and the rest, including
+ * the one being decoded, keep their previous values */
+bool jschema_decode(jschema_t *schema, const char *string, size_t len, void *object)
+attribute(nothrow);
+
+/* Encodes a C struct as a compact JSON object
+ * Returns true on normal operation
+ * Returns false and sets errno accordingly on error */
+bool jschema_encode(jschema_t *schema, const void *object, FILE *file)
+attribute(nothrow);
+
+/* Replaces the current version of a shared JSON object, taking ownership of it
+ * The replaced version is freed by a later call to jshared_reclaim().
+ * If 'json' is NULL, readers observe no current version until another is published.
+ * Returns true on normal operation
+ * Returns false and sets errno accordingly on error */
+bool jshared_publish(jshared_t *shared, json_t *json)
+attribute(nothrow);
 
 /* Removes a value from a JSON object
  * Returns true on normal operation
  * Returns false and sets errno accordingly on error */
 bool json_remove(json_t *json, const char *key);
 
+/* Removes the value of the given key, of given length, from a JSON object
+ * The key need not be NUL-terminated.
+ * Returns true on normal operation
+ * Returns false and sets errno accordingly on error */
+bool json_remove_len(json_t *json, const char *key, size_t len);
+
 /* Modifies a JSON value
  * Returns true on normal operation
  * Returns false and sets errno accordingly on error */
 bool jvalue_modify(jvalue_t *value, const jvalue_t *NEW_VALUE)
-attribute(nonnull, nothrow);
+attribute(nothrow);
+
+// Returns true if both JSON values are of the same type and structurally equal
+bool jvalue_equal(const jvalue_t *value1, const jvalue_t *value2)
+attribute(nothrow);
 
+/* Compares two JSON values of the same type, returning -1, 0 or 1
+ * Arrays and objects are ordered by size, then by their members in order */
 int jvalue_cmp(const jvalue_t *value1, const jvalue_t *value2)
-attribute(nonnull, nothrow);
+attribute(nothrow);
 
 bool jarray_pushb(jarray_t *array, const jvalue_t *value)
-attribute(nonnull, nothrow);
+attribute(nothrow);
 
 bool jarray_pushf(jarray_t *array, const jvalue_t *value)
-attribute(nonnull, nothrow);
+attribute(nothrow);
 
 bool jarray_remove(jarray_t *array, size_t index)
-attribute(nonnull, nothrow);
+attribute(nothrow);
 
 bool jarray_sort(jarray_t *array)
-attribute(nonnull, nothrow);
+attribute(nothrow);
+
+/* Returns canonical structural hash of a JSON object
+ * Equal objects have equal hashes, regardless of insertion order.
+ * The hash is cached within the object until it, or anything it holds,
+ * is modified through this library; hashing is therefore not safe
+ * alongside concurrent readers of the same object. */
+size_t json_hash(const json_t *json)
+attribute(nothrow);
 
+// Returns number of entries in a JSON object
 size_t json_size(const json_t *restrict json)
-attribute(nonnull, nothrow);
+attribute(nothrow);
+
+// Returns canonical structural hash of a JSON value, as for json_hash()
+size_t jvalue_hash(const jvalue_t *value)
+attribute(nothrow);
+
+/* Frees replaced versions that no reader can still observe
+ * Returns number of versions freed */
+size_t jshared_reclaim(jshared_t *shared)
+attribute(nothrow);
+
+/* Returns total number of bytes held by a JSON value, including itself
+ * If 'usage' is not NULL, adds the bytes held by each kind of node to it */
+size_t jvalue_memory_usage(const jvalue_t *value, jmemory_t *usage)
+attribute(nothrow);
+
+// Returns snapshot of library-wide counters
+jstats_t json_stats(void)
+attribute(nothrow);
+
+// Resets timing and operation counters, leaving byte counts intact
+void json_stats_reset(void)
+attribute(nothrow);
+
+// Returns cursor over every entry of a JSON object
+jcursor_t json_cursor(const json_t *json)
+attribute(nothrow);
+
+/* Returns cursor over entries of a JSON object whose keys lie within [lo, hi)
+ * Either bound may be NULL, leaving that side of the range open.
+ * The bounds are located in O(log n) time. */
+jcursor_t json_range(const json_t *json, const char *lo, const char *hi)
+attribute(nothrow);
+
+/* Returns cursor over entries of a JSON object whose keys begin with the given prefix
+ * The run is located in O(log n) time, as for json_range(). */
+jcursor_t json_prefix(const json_t *json, const char *prefix)
+attribute(nothrow);
 
 jarray_t *jarray_copy(const jarray_t *restrict array)
-attribute(nonnull, nothrow, warn_unused_result);
+attribute(nothrow, warn_unused_result);
 
 /* Generates a new, empty JSON array
  * Returns NULL and sets errno accordingly on error */
 jarray_t *jarray_new(void)
 attribute(nothrow, warn_unused_result);
 
+/* Generates an RFC 6902 JSON Patch transforming one JSON object into another
+ * Both objects are hashed, then walked together in key order, skipping
+ * equal subtrees; array members are aligned as described by JDIFF_LCSMAX.
+ * Hashes are held in a table of their own, so neither object is modified,
+ * and either may be shared with concurrent readers.
+ * Returns NULL and sets errno accordingly on error */
+jarray_t *json_diff(const json_t *json1, const json_t *json2)
+attribute(nothrow, warn_unused_result);
+
 json_t *json_copy(const json_t *json)
-attribute(nonnull, nothrow, warn_unused_result);
+attribute(nothrow, warn_unused_result);
 
 /* Generates a new, empty JSON object
  * Returns NULL and sets errno to ENOMEM on error */
@@ -173,43 +491,100 @@ json_t *json_new(void)
 attribute(nothrow, warn_unused_result);
 
 /* Generates a new JSON object from a .json file
- * Returns NULL and sets errno accordingly on error
- *
- * Show errors here */
-json_t *json_parse(const FILE *file)
-attribute(nonnull, nothrow, warn_unused_result);
+ * Returns NULL and sets errno accordingly on error:
+ *     EILSEQ   Input is malformed, or nested deeper than JSON_MAXDEPTH
+ *     ERANGE   A number is too large to be represented by jfloat_t
+ *     ENOMEM   Memory could not be allocated
+ * If keys repeat, the last value is kept.
+ * Strings must be valid UTF-8. Those holding U+0000 are rejected,
+ * as they cannot be stored. */
+json_t *json_parse(FILE *file)
+attribute(nothrow, warn_unused_result);
+
+/* Begins a read section, returning the current version of the shared object
+ * The object remains valid until jshared_leave() is called, and must not be modified */
+const json_t *jshared_enter(jreader_t *reader)
+attribute(nothrow);
+
+/* Generates a new reader of a shared JSON object
+ * Returns NULL and sets errno accordingly on error */
+jreader_t *jshared_register(jshared_t *shared)
+attribute(nothrow, warn_unused_result);
+
+/* Generates a new shared JSON object, taking ownership of the given object
+ * Returns NULL and sets errno to ENOMEM on error */
+jshared_t *jshared_new(json_t *json)
+attribute(nothrow, warn_unused_result);
 
 jvalue_t *jarray_findf(jarray_t *array, const jvalue_t *value)
-attribute(nonnull, nothrow);
+attribute(nothrow);
 
 jvalue_t *jarray_findfn(jarray_t *array, const jvalue_t *value)
-attribute(nonnull, nothrow);
+attribute(nothrow);
 
 jvalue_t *jarray_findl(jarray_t *array, const jvalue_t *value)
-attribute(nonnull, nothrow);
+attribute(nothrow);
 
 jvalue_t *jarray_findln(jarray_t *array, const jvalue_t *value)
-attribute(nonnull, nothrow);
+attribute(nothrow);
 
 jvalue_t *jarray_get(const jarray_t *array, size_t index)
-attribute(nonnull, nothrow);
+attribute(nothrow);
 
 jvalue_t *jarray_popf(jarray_t *array)
-attribute(nonnull, nothrow, warn_unused_result);
+attribute(nothrow, warn_unused_result);
 
 jvalue_t *jarray_popb(jarray_t *array)
-attribute(nonnull, nothrow, warn_unused_result);
+attribute(nothrow, warn_unused_result);
 
 /* Returns the value of the given key within the JSON object
- * Returns NULL on error or if no value is found */
+ * Returns NULL on error or if no value is found
+ * Does not modify the object, so may be called by concurrent readers */
 jvalue_t *json_find(const json_t *json, const char *key)
-attribute(nonnull, nothrow);
+attribute(nothrow);
+
+/* Returns the value of the given key, of given length, within the JSON object
+ * The key need not be NUL-terminated.
+ * Returns NULL on error or if no value is found */
+jvalue_t *json_find_len(const json_t *json, const char *key, size_t len)
+attribute(nothrow);
 
 jvalue_t *jvalue_copy(const jvalue_t *restrict value)
 attribute(nothrow, warn_unused_result);
 
+/* Generates a new JSON value, taking ownership of its string, array or object
+ * Strings must have been allocated with malloc(), and arrays and objects
+ * by this library, without being held by another array or object.
+ * Returns NULL and sets errno accordingly on error */
 jvalue_t *jvalue_new(char type, const jany_t value)
 attribute(nothrow, warn_unused_result);
 
+// Returns the value held by an entry of a JSON object
+jvalue_t *jentry_value(const jentry_t *entry)
+attribute(nothrow);
+
+/* Returns the entry of a JSON object with the smallest key
+ * Returns NULL if the object is empty */
+jentry_t *json_first(const json_t *json)
+attribute(nothrow);
+
+/* Returns the entry following the given one in key order
+ * Returns NULL if it is the last */
+jentry_t *jentry_next(const jentry_t *entry)
+attribute(nothrow);
+
+// Returns the key of an entry of a JSON object
+const char *jentry_key(const jentry_t *entry)
+attribute(nothrow);
+
+/* Returns the next entry visited by a cursor, advancing it
+ * Returns NULL once the cursor is exhausted */
+jentry_t *jcursor_next(jcursor_t *cursor)
+attribute(nothrow);
+
+#ifdef __cplusplus
+}   // extern "C"
+#endif
+
 #include <ladle/common/undefs.h>
 #endif  // #ifndef LADLE_JSON_H
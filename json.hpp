@@ -0,0 +1,442 @@
+#ifndef LADLE_JSON_HPP
+#define LADLE_JSON_HPP
+#include <cerrno>           // errno
+#include <cstddef>          // std::size_t, std::ptrdiff_t
+#include <cstdio>           // FILE
+#include <cstdlib>          // std::malloc(), std::free()
+#include <cstring>          // std::memcpy()
+#include <iterator>         // iterator tags
+#include <new>              // std::bad_alloc
+#include <optional>         // std::optional
+#include <stdexcept>        // std::logic_error, std::out_of_range
+#include <string_view>      // std::string_view
+#include <system_error>     // std::system_error
+#include <type_traits>      // std::is_same_v, std::is_arithmetic_v
+#include <utility>          // std::exchange()
+#include "json.h"
+
+/* C++17 interface to libjson
+ * Owning handles (value, array, object) free what they hold when destroyed,
+ * and are moved rather than copied; copy() makes a deep copy when one is needed.
+ * Moving a value into an array or object hands it to the C library without copying.
+ * References (value_ref, array_ref, object_ref) borrow from their owner,
+ * and are valid while it is alive and the referenced node is not removed.
+ * Failures of the C library are thrown as std::system_error, holding errno. */
+namespace ladle::json {
+namespace detail {
+// Throws error reported by the C library
+[[noreturn]] inline void raise(int err = errno) {
+    throw std::system_error(err, std::generic_category());
+}
+
+// Returns pointer, throwing if the call producing it failed
+template <typename T>
+inline T *check(T *ptr) {
+    if (!ptr)
+        raise();
+    return ptr;
+}
+
+// Throws if the call returning 'success' failed
+inline void check(bool success) {
+    if (!success)
+        raise();
+}
+
+// Data of string view, as accepted by the C library
+inline const char *data(std::string_view key) noexcept {
+    return key.data() ? key.data() : "";
+}
+
+template <typename>
+inline constexpr bool always_false = false;
+}   // namespace detail
+
+// Thrown when a value is read as a type it does not hold
+class type_error : public std::logic_error {
+public:
+    using std::logic_error::logic_error;
+};
+
+class value;
+class array_ref;
+class object_ref;
+
+// Borrowed JSON value
+class value_ref {
+public:
+    explicit value_ref(jvalue_t *value) noexcept : ptr(value) {}
+
+    jtype_t type() const noexcept { return static_cast<jtype_t>(ptr->type); }
+    bool is_null() const noexcept { return ptr->type == J_NULL; }
+
+    // Returns true if value holds the type read by get<T>()
+    template <typename T>
+    bool is() const noexcept { return ptr->type == type_of<T>(); }
+
+    /* Returns value as given type, throwing type_error if it holds another
+     * T may be bool, any arithmetic type, std::string_view, const char *,
+     * array_ref or object_ref, and is resolved at compile time. */
+    template <typename T>
+    T get() const;
+
+    value copy() const;
+
+    bool operator==(value_ref other) const noexcept { return jvalue_equal(ptr, other.ptr); }
+    bool operator!=(value_ref other) const noexcept { return !jvalue_equal(ptr, other.ptr); }
+
+    jvalue_t *c_ptr() const noexcept { return ptr; }
+protected:
+    // Returns JSON type read as T
+    template <typename T>
+    static constexpr jtype_t type_of() noexcept {
+        if constexpr (std::is_same_v<T, bool>)
+            return J_BOOL;
+        else if constexpr (std::is_arithmetic_v<T>)
+            return J_NUM;
+        else if constexpr (std::is_same_v<T, std::string_view> || std::is_same_v<T, const char *>)
+            return J_STR;
+        else if constexpr (std::is_same_v<T, array_ref>)
+            return J_ARR;
+        else if constexpr (std::is_same_v<T, object_ref>)
+            return J_OBJ;
+        else
+            static_assert(detail::always_false<T>, "get<T>() does not support this type");
+    }
+
+    jvalue_t *ptr;
+};
+
+// Borrowed JSON array
+class array_ref {
+public:
+    /* Input iterator over members, yielding value_ref by value
+     * Supports random-access arithmetic, but dereferencing returns a proxy,
+     * so algorithms that reorder members through it are not supported; use sort(). */
+    class iterator {
+    public:
+        using iterator_category = std::input_iterator_tag;
+        using value_type = value_ref;
+        using difference_type = std::ptrdiff_t;
+        using pointer = void;
+        using reference = value_ref;
+
+        iterator() noexcept = default;
+        explicit iterator(jvalue_t **pos) noexcept : pos(pos) {}
+
+        reference operator*() const noexcept { return value_ref(*pos); }
+        reference operator[](difference_type n) const noexcept { return value_ref(pos[n]); }
+
+        iterator &operator++() noexcept { ++pos; return *this; }
+        iterator &operator--() noexcept { --pos; return *this; }
+        iterator operator++(int) noexcept { return iterator(pos++); }
+        iterator operator--(int) noexcept { return iterator(pos--); }
+        iterator &operator+=(difference_type n) noexcept { pos += n; return *this; }
+        iterator &operator-=(difference_type n) noexcept { pos -= n; return *this; }
+
+        friend iterator operator+(iterator it, difference_type n) noexcept { return it += n; }
+        friend iterator operator+(difference_type n, iterator it) noexcept { return it += n; }
+        friend iterator operator-(iterator it, difference_type n) noexcept { return it -= n; }
+        friend difference_type operator-(iterator lhs, iterator rhs) noexcept { return lhs.pos - rhs.pos; }
+
+        friend bool operator==(iterator lhs, iterator rhs) noexcept { return lhs.pos == rhs.pos; }
+        friend bool operator!=(iterator lhs, iterator rhs) noexcept { return lhs.pos != rhs.pos; }
+        friend bool operator<(iterator lhs, iterator rhs) noexcept { return lhs.pos < rhs.pos; }
+        friend bool operator>(iterator lhs, iterator rhs) noexcept { return lhs.pos > rhs.pos; }
+        friend bool operator<=(iterator lhs, iterator rhs) noexcept { return lhs.pos <= rhs.pos; }
+        friend bool operator>=(iterator lhs, iterator rhs) noexcept { return lhs.pos >= rhs.pos; }
+    private:
+        jvalue_t **pos = nullptr;
+    };
+
+    explicit array_ref(jarray_t *array) noexcept : ptr(array) {}
+
+    std::size_t size() const noexcept { return ptr->size; }
+    bool empty() const noexcept { return !ptr->size; }
+
+    iterator begin() const noexcept { return iterator(ptr->values); }
+    iterator end() const noexcept { return iterator(ptr->values + ptr->size); }
+
+    value_ref operator[](std::size_t index) const noexcept { return value_ref(ptr->values[index]); }
+
+    value_ref at(std::size_t index) const {
+        if (index >= ptr->size)
+            throw std::out_of_range("JSON array index out of range");
+        return value_ref(ptr->values[index]);
+    }
+
+    // Appends value, handing it to the array without copying
+    void push_back(value &&member);
+
+    // Removes last member, returning ownership of it
+    value pop_back();
+
+    void erase(std::size_t index) { detail::check(jarray_remove(ptr, index)); }
+    void sort() { detail::check(jarray_sort(ptr)); }
+
+    jarray_t *c_ptr() const noexcept { return ptr; }
+protected:
+    jarray_t *ptr;
+};
+
+// Entry of a borrowed JSON object
+struct entry {
+    std::string_view key;
+    value_ref value;
+};
+
+// Borrowed JSON object
+class object_ref {
+public:
+    // Input iterator over entries, in key order, yielding entry by value
+    class iterator {
+    public:
+        using iterator_category = std::input_iterator_tag;
+        using value_type = entry;
+        using difference_type = std::ptrdiff_t;
+        using pointer = void;
+        using reference = entry;
+
+        iterator() noexcept = default;
+        explicit iterator(jentry_t *pos) noexcept : pos(pos) {}
+
+        reference operator*() const noexcept {
+            return {jentry_key(pos), value_ref(jentry_value(pos))};
+        }
+
+        iterator &operator++() noexcept { pos = jentry_next(pos); return *this; }
+
+        iterator operator++(int) noexcept {
+            iterator prev = *this;
+
+            pos = jentry_next(pos);
+            return prev;
+        }
+
+        friend bool operator==(iterator lhs, iterator rhs) noexcept { return lhs.pos == rhs.pos; }
+        friend bool operator!=(iterator lhs, iterator rhs) noexcept { return lhs.pos != rhs.pos; }
+    private:
+        jentry_t *pos = nullptr;
+    };
+
+    explicit object_ref(json_t *json) noexcept : ptr(json) {}
+
+    std::size_t size() const noexcept { return ptr->size; }
+    bool empty() const noexcept { return !ptr->size; }
+
+    iterator begin() const noexcept { return iterator(json_first(ptr)); }
+    iterator end() const noexcept { return iterator(); }
+
+    // Returns value of key, if present, without copying the key
+    std::optional<value_ref> find(std::string_view key) const noexcept {
+        jvalue_t *value = json_find_len(ptr, detail::data(key), key.size());
+
+        return value ? std::optional<value_ref>(value_ref(value)) : std::nullopt;
+    }
+
+    bool contains(std::string_view key) const noexcept {
+        return json_find_len(ptr, detail::data(key), key.size());
+    }
+
+    value_ref at(std::string_view key) const {
+        jvalue_t *value = json_find_len(ptr, detail::data(key), key.size());
+
+        if (!value)
+            throw std::out_of_range("JSON object has no such key");
+        return value_ref(value);
+    }
+
+    // Adds or replaces value of key, handing it to the object without copying
+    void insert(std::string_view key, value &&member);
+
+    // Removes key, returning false if it is not present
+    bool erase(std::string_view key) {
+        if (json_remove_len(ptr, detail::data(key), key.size()))
+            return true;
+        if (errno != ENOENT)
+            detail::raise();
+        return false;
+    }
+
+    // Applies patch as an RFC 7386 JSON Merge Patch
+    void merge(object_ref patch) { detail::check(json_merge(ptr, patch.ptr)); }
+
+    void print(FILE *file, std::size_t indent = 0) const {
+        detail::check(json_print(ptr, file, indent));
+    }
+
+    std::size_t hash() const noexcept { return json_hash(ptr); }
+
+    bool operator==(object_ref other) const noexcept { return json_equal(ptr, other.ptr); }
+    bool operator!=(object_ref other) const noexcept { return !json_equal(ptr, other.ptr); }
+
+    json_t *c_ptr() const noexcept { return ptr; }
+protected:
+    json_t *ptr;
+};
+
+// Owned JSON array
+class array : public array_ref {
+public:
+    array() : array_ref(detail::check(jarray_new())) {}
+    explicit array(jarray_t *array) noexcept : array_ref(array) {}    // Takes ownership
+    array(array &&other) noexcept : array_ref(std::exchange(other.ptr, nullptr)) {}
+    array(const array &) = delete;
+    ~array() { if (ptr) jarray_free(ptr); }
+
+    array &operator=(array &&other) noexcept {
+        if (this != &other) {
+            if (ptr)
+                jarray_free(ptr);
+            ptr = std::exchange(other.ptr, nullptr);
+        }
+        return *this;
+    }
+    array &operator=(const array &) = delete;
+
+    array copy() const { return array(detail::check(jarray_copy(ptr))); }
+
+    // Gives up ownership, leaving the handle empty
+    jarray_t *release() noexcept { return std::exchange(ptr, nullptr); }
+};
+
+// Owned JSON object
+class object : public object_ref {
+public:
+    object() : object_ref(detail::check(json_new())) {}
+    explicit object(json_t *json) noexcept : object_ref(json) {}      // Takes ownership
+    object(object &&other) noexcept : object_ref(std::exchange(other.ptr, nullptr)) {}
+    object(const object &) = delete;
+    ~object() { if (ptr) json_free(ptr); }
+
+    object &operator=(object &&other) noexcept {
+        if (this != &other) {
+            if (ptr)
+                json_free(ptr);
+            ptr = std::exchange(other.ptr, nullptr);
+        }
+        return *this;
+    }
+    object &operator=(const object &) = delete;
+
+    static object parse(FILE *file) { return object(detail::check(json_parse(file))); }
+
+    object copy() const { return object(detail::check(json_copy(ptr))); }
+
+    // Gives up ownership, leaving the handle empty
+    json_t *release() noexcept { return std::exchange(ptr, nullptr); }
+};
+
+// Owned JSON value
+class value : public value_ref {
+public:
+    value() : value(nullptr) {}
+    value(std::nullptr_t) : value_ref(make(J_NULL, jany_t())) {}
+    value(bool boolean) : value_ref(nullptr) {
+        jany_t any;
+
+        any.boolean = boolean;
+        ptr = make(J_BOOL, any);
+    }
+
+    template <typename T, std::enable_if_t<
+      std::is_arithmetic_v<T> && !std::is_same_v<T, bool>, int> = 0>
+    value(T number) : value_ref(nullptr) {
+        jany_t any;
+
+        any.number = static_cast<jfloat_t>(number);
+        ptr = make(J_NUM, any);
+    }
+
+    value(std::string_view string) : value_ref(nullptr) {
+        jany_t any;
+
+        any.string = static_cast<char *>(std::malloc(string.size() + 1));
+        if (!any.string)
+            throw std::bad_alloc();
+        std::memcpy(any.string, detail::data(string), string.size());
+        any.string[string.size()] = '\0';
+        if (!(ptr = jvalue_new(J_STR, any))) {
+            const int ERR = errno;
+
+            std::free(any.string);
+            detail::raise(ERR);
+        }   // jvalue_new() fails
+    }
+
+    value(const char *string) : value(std::string_view(string)) {}
+
+    // Takes ownership of array or object, without copying it
+    value(array &&other) : value_ref(nullptr) {
+        jany_t any;
+
+        any.array = other.c_ptr();
+        ptr = make(J_ARR, any);
+        other.release();
+    }
+
+    value(object &&other) : value_ref(nullptr) {
+        jany_t any;
+
+        any.object = other.c_ptr();
+        ptr = make(J_OBJ, any);
+        other.release();
+    }
+
+    explicit value(jvalue_t *other) noexcept : value_ref(other) {}    // Takes ownership
+    value(value &&other) noexcept : value_ref(std::exchange(other.ptr, nullptr)) {}
+    value(const value &) = delete;
+    ~value() { if (ptr) jvalue_free(ptr); }
+
+    value &operator=(value &&other) noexcept {
+        if (this != &other) {
+            if (ptr)
+                jvalue_free(ptr);
+            ptr = std::exchange(other.ptr, nullptr);
+        }
+        return *this;
+    }
+    value &operator=(const value &) = delete;
+
+    // Gives up ownership, leaving the handle empty
+    jvalue_t *release() noexcept { return std::exchange(ptr, nullptr); }
+private:
+    static jvalue_t *make(char type, jany_t any) { return detail::check(jvalue_new(type, any)); }
+};
+
+template <typename T>
+inline T value_ref::get() const {
+    constexpr jtype_t TYPE = type_of<T>();
+
+    if (ptr->type != TYPE)
+        throw type_error("JSON value does not hold the requested type");
+    if constexpr (TYPE == J_BOOL)
+        return ptr->value.boolean;
+    else if constexpr (TYPE == J_NUM)
+        return static_cast<T>(ptr->value.number);
+    else if constexpr (TYPE == J_STR)
+        return T(ptr->value.string);
+    else if constexpr (TYPE == J_ARR)
+        return array_ref(ptr->value.array);
+    else
+        return object_ref(ptr->value.object);
+}
+
+inline value value_ref::copy() const {
+    return value(detail::check(jvalue_copy(ptr)));
+}
+
+inline void array_ref::push_back(value &&member) {
+    detail::check(jarray_pushb_move(ptr, member.release()));
+}
+
+inline value array_ref::pop_back() {
+    return value(detail::check(jarray_popb(ptr)));
+}
+
+inline void object_ref::insert(std::string_view key, value &&member) {
+    detail::check(json_add_move(ptr, detail::data(key), key.size(), member.release()));
+}
+}   // namespace ladle::json
+
+#endif  // #ifndef LADLE_JSON_HPP
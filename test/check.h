@@ -0,0 +1,61 @@
+/* Checks and runner shared by the tests under test/
+ *
+ * Build and run (from repository root), where the ladle/common headers are
+ * installed under LADLE_INCLUDE:
+ *     make test LADLE_INCLUDE=/usr/local/include
+ *
+ * Each failed check is reported on stderr; the exit status of a test program
+ * is nonzero if any of its tests fails. */
+#ifndef LADLE_JSON_TEST_CHECK_H
+#define LADLE_JSON_TEST_CHECK_H
+
+#include <errno.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include "../json.h"
+
+// Reports failed check, returning from the enclosing test
+#define check(cond)                                                         \
+    do {                                                                    \
+        if (!(cond)) {                                                      \
+            fprintf(stderr, "%s:%d: %s: check failed: %s\n",                \
+              __FILE__, __LINE__, __func__, #cond);                         \
+            return false;                                                   \
+        }                                                                   \
+    } while (0)
+
+/* Parses JSON object held by string
+ * Returns NULL and sets errno accordingly on error */
+static inline json_t *parse(const char *string) {
+    FILE *file = tmpfile();
+    json_t *json = NULL;
+    int error;
+
+    if (!file)  // tmpfile() fails
+        return NULL;
+    if (fputs(string, file) != EOF) {
+        rewind(file);
+        json = json_parse(file);
+    }
+    error = errno;
+    fclose(file);
+    errno = error;
+    return json;
+}
+
+// Defines main(), running every given test and failing if any does
+#define test_main(...)                                                      \
+    int main(void) {                                                        \
+        bool (*const TESTS[])(void) = {__VA_ARGS__};                        \
+        int status = EXIT_SUCCESS;                                          \
+                                                                            \
+        for (size_t i = 0; i < sizeof TESTS / sizeof TESTS[0]; ++i) {       \
+            if (!TESTS[i]())                                                \
+                status = EXIT_FAILURE;                                      \
+        }                                                                   \
+        return status;                                                      \
+    }
+
+#endif  // #ifndef LADLE_JSON_TEST_CHECK_H
@@ -0,0 +1,115 @@
+// Tests for cursors over runs of entries of JSON objects
+#include <string.h>
+#include "../json.h"
+#include "check.h"
+
+// Keys of the object walked by most tests, in order
+#define KEYS    "{\"a\": 1, \"ab\": 2, \"abc\": 3, \"b\": 4, \"ba\": 5, \"c\": 6}"
+
+// Entries added when rebalancing
+#define REBALANCED  1000
+
+/* Returns true if cursor visits the keys in expected, separated by commas,
+ * and nothing else */
+static bool visits(jcursor_t cursor, const char *expected) {
+    char keys[256] = "";
+    size_t len = 0;
+
+    for (const jentry_t *entry; len < sizeof keys && (entry = jcursor_next(&cursor));)
+        len += snprintf(keys + len, sizeof keys - len, "%s%s", len ? "," : "", jentry_key(entry));
+    if (len < sizeof keys && !strcmp(keys, expected) && !jcursor_next(&cursor))
+        return true;
+    fprintf(stderr, "cursor visits \"%s\" instead of \"%s\"\n", keys, expected);
+    return false;
+}
+
+static bool test_empty_object(void) {
+    json_t *json = json_new();
+
+    check(json);
+    check(visits(json_cursor(json), ""));
+    check(visits(json_range(json, NULL, NULL), ""));
+    check(visits(json_range(json, "a", "z"), ""));
+    check(visits(json_prefix(json, ""), ""));
+    check(visits(json_prefix(json, "a"), ""));
+    json_free(json);
+    return true;
+}
+
+static bool test_range(void) {
+    json_t *json = parse(KEYS);
+
+    check(json);
+    check(visits(json_range(json, NULL, NULL), "a,ab,abc,b,ba,c"));
+    check(visits(json_range(json, "ab", "b"), "ab,abc"));    // Lower bound included
+    check(visits(json_range(json, "aa", "bb"), "ab,abc,b,ba"));
+    check(visits(json_range(json, NULL, "ab"), "a"));
+    check(visits(json_range(json, "ba", NULL), "ba,c"));
+    check(visits(json_range(json, "d", NULL), ""));
+    check(visits(json_range(json, "b", "b"), ""));          // lo == hi
+    check(visits(json_range(json, "c", "a"), ""));          // lo > hi
+    json_free(json);
+    return true;
+}
+
+static bool test_prefix(void) {
+    json_t *json = parse(KEYS);
+
+    check(json);
+    check(visits(json_prefix(json, ""), "a,ab,abc,b,ba,c"));
+    check(visits(json_prefix(json, "a"), "a,ab,abc"));      // Prefix is itself a key
+    check(visits(json_prefix(json, "ab"), "ab,abc"));
+    check(visits(json_prefix(json, "abc"), "abc"));
+    check(visits(json_prefix(json, "b"), "b,ba"));
+    check(visits(json_prefix(json, "aa"), ""));             // Sorts between keys
+    check(visits(json_prefix(json, "d"), ""));              // Sorts after last key
+    check(visits(json_prefix(json, "0"), ""));              // Sorts before first key
+    json_free(json);
+    return true;
+}
+
+/* Returns true if cursor visits keys of the form "k%04d" for each of
+ * [first, last) that is not a multiple of skip, in increasing order */
+static bool visits_numbered(jcursor_t cursor, int first, int last, int skip) {
+    char key[16];
+    const jentry_t *entry;
+
+    for (int i = first; i < last; ++i) {
+        if (skip && i % skip == 0)
+            continue;
+        snprintf(key, sizeof key, "k%04d", i);
+        entry = jcursor_next(&cursor);
+        if (!entry || strcmp(jentry_key(entry), key)) {
+            fprintf(stderr, "cursor visits %s instead of %s\n", entry ? jentry_key(entry) : "nothing", key);
+            return false;
+        }
+    }
+    return !jcursor_next(&cursor);
+}
+
+// Cursors visit every entry in order after insertions and removals have rebalanced the tree
+static bool test_rebalanced(void) {
+    json_t *json = json_new();
+    const jvalue_t VALUE = {.type = J_NULL};
+    char key[16];
+
+    check(json);
+    for (int i = 0; i < REBALANCED; ++i) {  // Ascending keys rotate at every level
+        snprintf(key, sizeof key, "k%04d", i);
+        check(json_add(json, key, &VALUE));
+    }
+    check(visits_numbered(json_cursor(json), 0, REBALANCED, 0));
+    check(visits_numbered(json_range(json, "k0250", "k0750"), 250, 750, 0));
+    check(visits_numbered(json_prefix(json, "k05"), 500, 600, 0));
+    for (int i = 0; i < REBALANCED; i += 3) {
+        snprintf(key, sizeof key, "k%04d", i);
+        check(json_remove(json, key));
+    }
+    check(visits_numbered(json_cursor(json), 0, REBALANCED, 3));
+    check(visits_numbered(json_range(json, "k0100", "k0901"), 100, 901, 3));
+    check(visits_numbered(json_prefix(json, "k09"), 900, 1000, 3));
+    json_free(json);
+    return true;
+}
+
+test_main(test_empty_object, test_range, test_prefix, test_rebalanced)
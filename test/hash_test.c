@@ -0,0 +1,109 @@
+// Tests for invalidation of cached structural hashes
+#include "../json.h"
+#include "check.h"
+
+// Object whose members are modified below its top level
+#define NESTED  "{\"a\": {\"b\": [1, {\"c\": 2}], \"d\": \"x\"}, \"e\": 3}"
+
+/* Parses NESTED, caching the hashes of the object and everything it holds
+ * Returns NULL and sets errno accordingly on error */
+static json_t *hashed(void) {
+    json_t *json = parse(NESTED);
+
+    if (json)
+        json_hash(json);
+    return json;
+}
+
+// Returns array "b" of object "a" of NESTED
+static jarray_t *inner_array(const json_t *json) {
+    return json_find(json_find(json, "a")->value.object, "b")->value.array;
+}
+
+// Returns object held by array "b" of NESTED
+static json_t *inner_object(const json_t *json) {
+    return jarray_get(inner_array(json), 1)->value.object;
+}
+
+/* Returns true if hashing and comparing json, hashed before being modified,
+ * no longer agree with a fresh copy of NESTED, but do with the object held by result */
+static bool rehashes(json_t *json, const char *result) {
+    json_t *original = parse(NESTED), *expected = parse(result);
+    bool success = original && expected;
+
+    success = success && json_hash(json) != json_hash(original) && !json_equal(json, original);
+    success = success && json_hash(json) == json_hash(expected) && json_equal(json, expected);
+    if (!success)
+        fprintf(stderr, "modified object does not hash and compare as %s\n", result);
+    json_free(original);
+    json_free(expected);
+    json_free(json);
+    return success;
+}
+
+static bool test_array_pushb(void) {
+    json_t *json = hashed();
+    const jvalue_t VALUE = {.type = J_NUM, .value = {.number = 3}};
+
+    check(json);
+    check(jarray_pushb(inner_array(json), &VALUE));
+    check(rehashes(json, "{\"a\": {\"b\": [1, {\"c\": 2}, 3], \"d\": \"x\"}, \"e\": 3}"));
+    return true;
+}
+
+static bool test_array_remove(void) {
+    json_t *json = hashed();
+
+    check(json);
+    check(jarray_remove(inner_array(json), 0));
+    check(rehashes(json, "{\"a\": {\"b\": [{\"c\": 2}], \"d\": \"x\"}, \"e\": 3}"));
+    return true;
+}
+
+static bool test_value_modify(void) {
+    json_t *json = hashed();
+    const jvalue_t VALUE = {.type = J_BOOL, .value = {.boolean = true}};
+
+    check(json);
+    check(jvalue_modify(json_find(inner_object(json), "c"), &VALUE));
+    check(rehashes(json, "{\"a\": {\"b\": [1, {\"c\": true}], \"d\": \"x\"}, \"e\": 3}"));
+    return true;
+}
+
+static bool test_object_add(void) {
+    json_t *json = hashed();
+    const jvalue_t VALUE = {.type = J_NULL};
+
+    check(json);
+    check(json_add(inner_object(json), "f", &VALUE));
+    check(rehashes(json, "{\"a\": {\"b\": [1, {\"c\": 2, \"f\": null}], \"d\": \"x\"}, \"e\": 3}"));
+    return true;
+}
+
+static bool test_object_remove(void) {
+    json_t *json = hashed();
+
+    check(json);
+    check(json_remove(json_find(json, "a")->value.object, "d"));
+    check(rehashes(json, "{\"a\": {\"b\": [1, {\"c\": 2}]}, \"e\": 3}"));
+    return true;
+}
+
+// json_diff() hashes into a table of its own, leaving the caches of its inputs empty
+static bool test_diff_leaves_caches(void) {
+    json_t *json1 = parse(NESTED), *json2 = parse("{\"a\": {\"b\": [1, {\"c\": 3}]}}");
+    jarray_t *patch = json1 && json2 ? json_diff(json1, json2) : NULL;
+
+    check(patch);
+    jarray_free(patch);
+    check(json1->node.hash == 0 && json2->node.hash == 0);
+    check(json_find(json1, "a")->value.object->node.hash == 0);
+    check(inner_array(json1)->node.hash == 0 && inner_array(json2)->node.hash == 0);
+    check(inner_object(json1)->node.hash == 0 && inner_object(json2)->node.hash == 0);
+    json_free(json1);
+    json_free(json2);
+    return true;
+}
+
+test_main(test_array_pushb, test_array_remove, test_value_modify, test_object_add,
+  test_object_remove, test_diff_leaves_caches)
@@ -0,0 +1,109 @@
+// Tests for the C++17 interface
+#include <algorithm>
+#include <iterator>
+#include <string_view>
+#include <type_traits>
+#include "../json.hpp"
+#include "check.h"
+
+using namespace ladle::json;
+using namespace std::literals;
+
+// Object walked by most tests
+#define MEMBERS "{\"a\": [1, 2.5, \"x\"], \"ab\": true, \"abc\": {\"d\": null}, \"s\": \"str\"}"
+
+// Iterators yield proxies by value, so are input iterators with random-access arithmetic
+static_assert(std::is_same_v<std::iterator_traits<array_ref::iterator>::iterator_category,
+  std::input_iterator_tag>);
+static_assert(std::is_same_v<std::iterator_traits<object_ref::iterator>::iterator_category,
+  std::input_iterator_tag>);
+static_assert(std::is_same_v<std::iterator_traits<array_ref::iterator>::reference, value_ref>);
+static_assert(std::is_same_v<std::iterator_traits<object_ref::iterator>::value_type, entry>);
+
+// Returns true if calling f throws type_error
+template <typename F>
+static bool throws_type_error(F f) {
+    try {
+        f();
+    } catch (const type_error &) {
+        return true;
+    }
+    return false;
+}
+
+static bool test_erase(void) {
+    object json(parse(MEMBERS));
+    constexpr std::string_view KEYS = "abcdef";
+
+    check(json.c_ptr());
+    check(json.erase(KEYS.substr(0, 2)));   // Removes "ab", not "abcdef"
+    check(!json.contains("ab") && json.contains("abc") && json.size() == 3);
+    check(!json.erase(KEYS.substr(0, 2)));  // No longer present
+    check(!json.erase(KEYS));
+    check(!json.erase(std::string_view())); // No data
+    check(json.erase("a"sv) && json.size() == 2);
+    return true;
+}
+
+static bool test_array_iterator(void) {
+    object json(parse(MEMBERS));
+
+    check(json.c_ptr());
+
+    const array_ref ARRAY = json.at("a").get<array_ref>();
+    const array_ref::iterator BEGIN = ARRAY.begin(), END = ARRAY.end();
+
+    check(END - BEGIN == 3 && std::distance(BEGIN, END) == 3);
+    check(BEGIN[2].is<std::string_view>() && (*(BEGIN + 1)).type() == J_NUM);
+    check((*(END - 1)).get<std::string_view>() == "x");
+    check(std::count_if(BEGIN, END, [](value_ref value) { return value.is<double>(); }) == 2);
+    check(BEGIN < END && END - 3 == BEGIN);
+
+    double sum = 0;
+
+    for (value_ref value : ARRAY) {
+        if (value.is<double>())
+            sum += value.get<double>();
+    }
+    check(sum == 3.5);
+    return true;
+}
+
+static bool test_object_iterator(void) {
+    object json(parse(MEMBERS));
+    std::string_view expected[] = {"a", "ab", "abc", "s"};
+    std::size_t i = 0;
+
+    check(json.c_ptr());
+    check(std::distance(json.begin(), json.end()) == 4);
+    for (const entry &member : json)
+        check(i < 4 && member.key == expected[i++]);
+    check(i == 4);
+    check(std::find_if(json.begin(), json.end(),
+      [](const entry &member) { return member.value.is_null(); }) == json.end());
+    return true;
+}
+
+static bool test_get(void) {
+    object json(parse(MEMBERS));
+
+    check(json.c_ptr());
+
+    const array_ref ARRAY = json.at("a").get<array_ref>();
+
+    check(ARRAY[0].get<int>() == 1 && ARRAY[1].get<double>() == 2.5);
+    check(ARRAY[1].get<int>() == 2);    // Converted as by static_cast
+    check(ARRAY[2].get<std::string_view>() == "x");
+    check(ARRAY[2].get<const char *>() == "x"sv);
+    check(json.at("ab").get<bool>());
+    check(json.at("abc").get<object_ref>().at("d").is_null());
+    check(json.at("s").is<std::string_view>() && json.at("s").is<const char *>());
+    check(!json.at("ab").is<int>() && !json.at("a").is<object_ref>());
+    check(throws_type_error([&] { json.at("ab").get<int>(); }));
+    check(throws_type_error([&] { ARRAY[0].get<bool>(); }));
+    check(throws_type_error([&] { json.at("s").get<array_ref>(); }));
+    check(throws_type_error([&] { json.at("abc").get<std::string_view>(); }));
+    return true;
+}
+
+test_main(test_erase, test_array_iterator, test_object_iterator, test_get)
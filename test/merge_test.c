@@ -0,0 +1,88 @@
+// Tests for RFC 7386 JSON Merge Patch
+#include <errno.h>
+#include "../json.h"
+#include "check.h"
+
+/* Returns true if merging patch into target gives result, both by copying
+ * and by moving the patch */
+static bool merges(const char *target, const char *patch, const char *result) {
+    json_t *dst1 = parse(target), *dst2 = parse(target);
+    json_t *src1 = parse(patch), *src2 = parse(patch), *expected = parse(result);
+    bool success = dst1 && dst2 && src1 && src2 && expected;
+
+    success = success && json_merge(dst1, src1) && json_equal(dst1, expected);
+    success = success && json_merge_move(dst2, src2) && json_equal(dst2, expected);
+    src2 = NULL;    // Freed by json_merge_move()
+    if (!success)
+        fprintf(stderr, "merging %s into %s does not give %s\n", patch, target, result);
+    json_free(dst1);
+    json_free(dst2);
+    json_free(src1);
+    json_free(src2);
+    json_free(expected);
+    return success;
+}
+
+// Examples of RFC 7386, Appendix A, whose target and patch are objects
+static bool test_appendix_a(void) {
+    check(merges("{\"a\": \"b\"}", "{\"a\": \"c\"}", "{\"a\": \"c\"}"));
+    check(merges("{\"a\": \"b\"}", "{\"b\": \"c\"}", "{\"a\": \"b\", \"b\": \"c\"}"));
+    check(merges("{\"a\": \"b\"}", "{\"a\": null}", "{}"));
+    check(merges("{\"a\": \"b\", \"b\": \"c\"}", "{\"a\": null}", "{\"b\": \"c\"}"));
+    check(merges("{\"a\": [\"b\"]}", "{\"a\": \"c\"}", "{\"a\": \"c\"}"));
+    check(merges("{\"a\": \"c\"}", "{\"a\": [\"b\"]}", "{\"a\": [\"b\"]}"));
+    check(merges("{\"a\": {\"b\": \"c\"}}", "{\"a\": {\"b\": \"d\", \"c\": null}}",
+      "{\"a\": {\"b\": \"d\"}}"));
+    check(merges("{\"a\": [{\"b\": \"c\"}]}", "{\"a\": [1]}", "{\"a\": [1]}"));
+    check(merges("{\"e\": null}", "{\"a\": 1}", "{\"e\": null, \"a\": 1}"));
+    check(merges("{}", "{\"a\": {\"bb\": {\"ccc\": null}}}", "{\"a\": {\"bb\": {}}}"));
+    return true;
+}
+
+// Examples of Appendix A whose target or patch is not an object, nested one level down
+static bool test_appendix_a_nested(void) {
+    check(merges("{\"x\": [\"a\", \"b\"]}", "{\"x\": [\"c\", \"d\"]}", "{\"x\": [\"c\", \"d\"]}"));
+    check(merges("{\"x\": {\"a\": \"b\"}}", "{\"x\": [\"c\"]}", "{\"x\": [\"c\"]}"));
+    check(merges("{\"x\": {\"a\": \"foo\"}}", "{\"x\": null}", "{}"));
+    check(merges("{\"x\": {\"a\": \"foo\"}}", "{\"x\": \"bar\"}", "{\"x\": \"bar\"}"));
+    return true;
+}
+
+// Objects patching members that are not objects replace them, without their nulls
+static bool test_non_object_target(void) {
+    check(merges("{\"x\": [1, 2]}", "{\"x\": {\"a\": \"b\", \"c\": null}}",
+      "{\"x\": {\"a\": \"b\"}}"));
+    check(merges("{\"x\": 1}", "{\"x\": {\"y\": {\"z\": null}}}", "{\"x\": {\"y\": {}}}"));
+    check(merges("{\"x\": 1, \"y\": 2}", "{}", "{\"x\": 1, \"y\": 2}"));
+    return true;
+}
+
+// Merging an object into itself only removes its nulls
+static bool test_self_merge(void) {
+    json_t *json = parse("{\"a\": null, \"b\": {\"c\": null, \"d\": 1}, \"e\": [null]}");
+    json_t *expected = parse("{\"b\": {\"d\": 1}, \"e\": [null]}");
+
+    check(json && expected);
+    check(json_merge(json, json));
+    check(json_equal(json, expected));
+    json_free(json);
+    json_free(expected);
+    return true;
+}
+
+// Moving an object into itself fails without freeing it; a NULL dst still frees src
+static bool test_move_errors(void) {
+    json_t *json = parse("{\"a\": null, \"b\": 1}");
+
+    check(json);
+    errno = 0;
+    check(!json_merge_move(json, json) && errno == EINVAL);
+    check(json_size(json) == 2);    // Still valid and unchanged
+    check(!json_merge_move(NULL, json) && errno == EINVAL);  // Frees json
+    check(!json_merge_move(NULL, NULL) && errno == EINVAL);
+    check(!json_merge(NULL, NULL) && errno == EINVAL);
+    return true;
+}
+
+test_main(test_appendix_a, test_appendix_a_nested, test_non_object_target, test_self_merge,
+  test_move_errors)
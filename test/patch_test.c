@@ -0,0 +1,175 @@
+// Tests for RFC 6902 JSON Patch generation and application
+#include <errno.h>
+#include <string.h>
+#include "../json.h"
+#include "check.h"
+
+/* Applies patch, given as a JSON array of operations, to object
+ * Returns true if applying it gives result, or fails with the given errno if result is NULL */
+static bool patches(const char *target, const char *patch, const char *result, int error) {
+    char text[1024];
+    json_t *json = parse(target), *holder, *expected = result ? parse(result) : NULL;
+    const jvalue_t *OPS;
+    bool success = false;
+
+    snprintf(text, sizeof text, "{\"ops\": %s}", patch);
+    holder = parse(text);
+    OPS = holder ? json_find(holder, "ops") : NULL;
+    if (json && OPS && OPS->type == J_ARR && (!result || expected)) {
+        errno = 0;
+        success = json_patch_apply(json, OPS->value.array);
+        success = result ? success && json_equal(json, expected) : !success && errno == error;
+    }
+    if (!success)
+        fprintf(stderr, "applying %s to %s does not give %s\n", patch, target,
+          result ? result : strerror(error));
+    json_free(json);
+    json_free(holder);
+    json_free(expected);
+    return success;
+}
+
+// Returns true if the patch generated from one object to another transforms the first into the second
+static bool round_trips(const char *from, const char *to) {
+    json_t *json1 = parse(from), *json2 = parse(to);
+    jarray_t *patch = json1 && json2 ? json_diff(json1, json2) : NULL;
+    bool success = patch && json_patch_apply(json1, patch) && json_equal(json1, json2);
+
+    if (!success)
+        fprintf(stderr, "diff from %s to %s does not round-trip\n", from, to);
+    json_free(json1);
+    json_free(json2);
+    if (patch)
+        jarray_free(patch);
+    return success;
+}
+
+static bool test_round_trip(void) {
+    check(round_trips("{}", "{}"));
+    check(round_trips("{\"a\": 1}", "{}"));
+    check(round_trips("{}", "{\"a\": {\"b\": [1, 2]}}"));
+    check(round_trips("{\"a\": 1, \"b\": \"x\", \"c\": null}", "{\"a\": 2, \"c\": null, \"d\": true}"));
+    check(round_trips("{\"a\": [1, 2, 3, 4, 5]}", "{\"a\": [1, 6, 3, 5, 7]}"));
+    check(round_trips("{\"a\": [1, 2, 3]}", "{\"a\": {\"0\": 1}}"));
+    check(round_trips("{\"a\": {\"b\": {\"c\": [{\"d\": 1}, 2]}}}",
+      "{\"a\": {\"b\": {\"c\": [2, {\"d\": 2}], \"e\": []}}}"));
+    check(round_trips("{\"a/b\": 1, \"m~n\": [1]}", "{\"a/b\": 2, \"m~n\": [1, 2]}"));
+    return true;
+}
+
+static bool test_operations(void) {
+    check(patches("{\"a\": 1}", "[{\"op\": \"add\", \"path\": \"/b\", \"value\": [1]}]",
+      "{\"a\": 1, \"b\": [1]}", 0));
+    check(patches("{\"a\": [1, 3]}", "[{\"op\": \"add\", \"path\": \"/a/1\", \"value\": 2}]",
+      "{\"a\": [1, 2, 3]}", 0));
+    check(patches("{\"a\": 1, \"b\": 2}", "[{\"op\": \"remove\", \"path\": \"/a\"}]",
+      "{\"b\": 2}", 0));
+    check(patches("{\"a\": [1, 2]}", "[{\"op\": \"remove\", \"path\": \"/a/0\"}]",
+      "{\"a\": [2]}", 0));
+    check(patches("{\"a\": [1, 2]}", "[{\"op\": \"replace\", \"path\": \"/a/1\", \"value\": {}}]",
+      "{\"a\": [1, {}]}", 0));
+    check(patches("{\"a\": 1}", "[{\"op\": \"replace\", \"path\": \"\", \"value\": {\"b\": 2}}]",
+      "{\"b\": 2}", 0));
+    check(patches("{\"a\": {\"b\": 1}, \"c\": []}",
+      "[{\"op\": \"move\", \"from\": \"/a/b\", \"path\": \"/c/0\"}]",
+      "{\"a\": {}, \"c\": [1]}", 0));
+    check(patches("{\"a\": {\"b\": 1}}", "[{\"op\": \"copy\", \"from\": \"/a\", \"path\": \"/c\"}]",
+      "{\"a\": {\"b\": 1}, \"c\": {\"b\": 1}}", 0));
+    check(patches("{\"a\": [1, {\"b\": null}]}",
+      "[{\"op\": \"test\", \"path\": \"/a\", \"value\": [1, {\"b\": null}]},"
+      " {\"op\": \"add\", \"path\": \"/c\", \"value\": 1}]",
+      "{\"a\": [1, {\"b\": null}], \"c\": 1}", 0));
+    return true;
+}
+
+// "~1" and "~0" within a reference token stand for "/" and "~"
+static bool test_pointer_escapes(void) {
+    check(patches("{\"a/b\": 1, \"m~n\": {\"~1\": 2}}",
+      "[{\"op\": \"replace\", \"path\": \"/a~1b\", \"value\": 3},"
+      " {\"op\": \"remove\", \"path\": \"/m~0n/~01\"}]",
+      "{\"a/b\": 3, \"m~n\": {}}", 0));
+    check(patches("{}", "[{\"op\": \"add\", \"path\": \"/~2\", \"value\": 1}]", NULL, EINVAL));
+    return true;
+}
+
+// "-" refers to the position past the last member of an array
+static bool test_append(void) {
+    check(patches("{\"a\": [1]}",
+      "[{\"op\": \"add\", \"path\": \"/a/-\", \"value\": 2},"
+      " {\"op\": \"copy\", \"from\": \"/a/0\", \"path\": \"/a/-\"}]",
+      "{\"a\": [1, 2, 1]}", 0));
+    check(patches("{\"a\": []}", "[{\"op\": \"add\", \"path\": \"/a/-\", \"value\": {}}]",
+      "{\"a\": [{}]}", 0));
+    return true;
+}
+
+static bool test_errors(void) {
+    check(patches("{\"a\": [1, 2]}", "[{\"op\": \"add\", \"path\": \"/a/3\", \"value\": 0}]",
+      NULL, ENOENT));
+    check(patches("{\"a\": [1, 2]}", "[{\"op\": \"remove\", \"path\": \"/a/2\"}]", NULL, ENOENT));
+    check(patches("{\"a\": [1, 2]}", "[{\"op\": \"replace\", \"path\": \"/a/5\", \"value\": 0}]",
+      NULL, ENOENT));
+    check(patches("{\"a\": 1}", "[{\"op\": \"add\", \"path\": \"/b/c\", \"value\": 0}]",
+      NULL, ENOENT));
+    check(patches("{\"a\": 1}", "[{\"op\": \"test\", \"path\": \"/a\", \"value\": 2}]",
+      NULL, ECANCELED));
+    check(patches("{\"a\": {\"b\": {}}}", "[{\"op\": \"move\", \"from\": \"/a\", \"path\": \"/a/b\"}]",
+      NULL, EINVAL));
+    check(patches("{\"a\": 1}", "[{\"op\": \"frob\", \"path\": \"/a\"}]", NULL, EINVAL));
+    return true;
+}
+
+// Builds object {"a": [first, first + 1, ...]} of given length
+static json_t *sequence(long first, size_t len) {
+    json_t *json = json_new();
+    jarray_t *array = jarray_new();
+    bool success = json && array;
+
+    for (size_t i = 0; success && i < len; ++i) {
+        const jvalue_t VALUE = {.type = J_NUM, .value = {.number = (jfloat_t) (first + (long) i)}};
+
+        success = jarray_pushb(array, &VALUE);
+    }
+
+    const jvalue_t ARRAY = {.type = J_ARR, .value = {.array = array}};
+
+    success = success && json_add(json, "a", &ARRAY);
+    if (array)
+        jarray_free(array);
+    if (!success) {
+        json_free(json);
+        return NULL;
+    }
+    return json;
+}
+
+/* Counts operations of patch generated from {"a": [0, 1, ...]} to the same shifted by one,
+ * checking that it round-trips; returns 0 on failure */
+static size_t shifted_ops(size_t len) {
+    json_t *json1 = sequence(0, len), *json2 = sequence(1, len);
+    jarray_t *patch = json1 && json2 ? json_diff(json1, json2) : NULL;
+    size_t ops = 0;
+
+    if (patch && json_patch_apply(json1, patch) && json_equal(json1, json2))
+        ops = patch->size;
+    json_free(json1);
+    json_free(json2);
+    if (patch)
+        jarray_free(patch);
+    return ops;
+}
+
+// Arrays are aligned by LCS up to JDIFF_LCSMAX pairs of members, then compared by position
+static bool test_lcs_limit(void) {
+    size_t small = 1, large;
+
+    while ((small + 2) * (small + 2) <= JDIFF_LCSMAX)
+        ++small;    // Largest length aligned by LCS
+    large = small + 1;
+    check(shifted_ops(small) == 2);     // Remove first, add last
+    check(shifted_ops(large) == large); // Replace each in place
+    return true;
+}
+
+test_main(test_round_trip, test_operations, test_pointer_escapes, test_append, test_errors,
+  test_lcs_limit)
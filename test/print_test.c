@@ -0,0 +1,82 @@
+// Tests for printing and reading back numbers and strings
+#define _POSIX_C_SOURCE 200809L     // open_memstream(), fmemopen()
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "../json.h"
+#include "check.h"
+
+/* Prints object holding value under key "x" without indentation
+ * Returns output, allocated with malloc(), or NULL on error */
+static char *print_value(const jvalue_t *value) {
+    json_t *json = json_new();
+    char *text = NULL;
+    size_t len;
+    FILE *file;
+
+    if (!json || !json_add(json, "x", value) || !(file = open_memstream(&text, &len))) {
+        json_free(json);
+        return NULL;
+    }
+    json_print(json, file, 0);
+    fclose(file);
+    json_free(json);
+    return text;
+}
+
+// Returns true if value is printed as expected and reads back equal
+static bool prints_as(const jvalue_t *value, const char *expected) {
+    char *text = print_value(value);
+    json_t *json = NULL;
+    bool success = false;
+    FILE *file;
+
+    if (text && (file = fmemopen(text, strlen(text), "r"))) {
+        json = json_parse(file);
+        fclose(file);
+        success = strstr(text, expected) && json && jvalue_equal(json_find(json, "x"), value);
+    }
+    if (!success)
+        fprintf(stderr, "expected %s, got %s", expected, text ? text : "nothing\n");
+    if (json)
+        json_free(json);
+    free(text);
+    return success;
+}
+
+// Returns true if number is printed as expected and reads back exactly
+#define number_prints_as(num, expected) \
+    prints_as(&(jvalue_t) {.type = J_NUM, .value = {.number = (num)}}, expected)
+
+static bool test_shortest_numbers(void) {
+    check(number_prints_as(0.1, "\"x\": 0.1\n"));
+    check(number_prints_as(-2998.75, "\"x\": -2998.75\n"));
+    check(number_prints_as(1e300, "\"x\": 1e+300\n"));
+    check(number_prints_as(0.1 + 0.2, "\"x\": 0.30000000000000004\n"));
+    check(number_prints_as(1.0 / 3, "\"x\": 0.3333333333333333\n"));
+    check(number_prints_as(2.2250738585072014e-308, "\"x\": 2.2250738585072014e-308\n"));
+    return true;
+}
+
+static bool test_escaped_strings(void) {
+    char text[] = "tab\there \"quoted\" back\\slash \x1B \xC3\xA9 \xE6\x97\xA5 \xF0\x9F\x98\x80";
+    const jvalue_t VALUE = {.type = J_STR, .value = {.string = text}};
+
+    check(prints_as(&VALUE,
+      "\"tab\\there \\\"quoted\\\" back\\\\slash \\u001b \xC3\xA9 \xE6\x97\xA5 \xF0\x9F\x98\x80\""));
+    return true;
+}
+
+static bool test_long_strings(void) {
+    char text[1000];
+    const jvalue_t VALUE = {.type = J_STR, .value = {.string = text}};
+
+    for (size_t i = 0; i < sizeof text - 1; ++i)   // Every ASCII character, then a long run
+        text[i] = i % 600 < 150 ? (char) (i % 127 + 1) : 'a';
+    text[sizeof text - 1] = '\0';
+    check(prints_as(&VALUE, "\\u0001\\u0002"));
+    return true;
+}
+
+test_main(test_shortest_numbers, test_escaped_strings, test_long_strings)
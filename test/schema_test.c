@@ -0,0 +1,139 @@
+// Tests for schema-compiled struct decoding
+#include <errno.h>
+#include <string.h>
+#include "../json.h"
+#include "check.h"
+
+typedef struct inner {
+    long long id;
+    char *label;
+    jvalue_t *extra;
+} inner;
+
+typedef struct outer {
+    long long n;
+    char *name;
+    inner in;
+} outer;
+
+typedef struct wide {   // Tracks more structs than fit on the stack
+    inner a, b, c, d, e, f, g, h, i, j, k, l, m, n, o, p, q;
+} wide;
+
+JSCHEMA(inner, inner,
+    JFIELD(inner, id, JF_INT),
+    JFIELD(inner, label, JF_STR),
+    JFIELD(inner, extra, JF_VALUE))
+
+JSCHEMA(outer, outer,
+    JFIELD_REQ(outer, n, JF_INT),
+    JFIELD(outer, name, JF_STR),
+    JFIELD_OBJ(outer, in, inner))
+
+JSCHEMA(wide, wide,
+    JFIELD_OBJ(wide, a, inner), JFIELD_OBJ(wide, b, inner), JFIELD_OBJ(wide, c, inner),
+    JFIELD_OBJ(wide, d, inner), JFIELD_OBJ(wide, e, inner), JFIELD_OBJ(wide, f, inner),
+    JFIELD_OBJ(wide, g, inner), JFIELD_OBJ(wide, h, inner), JFIELD_OBJ(wide, i, inner),
+    JFIELD_OBJ(wide, j, inner), JFIELD_OBJ(wide, k, inner), JFIELD_OBJ(wide, l, inner),
+    JFIELD_OBJ(wide, m, inner), JFIELD_OBJ(wide, n, inner), JFIELD_OBJ(wide, o, inner),
+    JFIELD_OBJ(wide, p, inner), JFIELD_OBJ(wide, q, inner))
+
+typedef struct scalars {
+    long long i;
+    jfloat_t f;
+    bool b;
+    char chars[8];
+    char *s;
+} scalars;
+
+JSCHEMA(scalars, scalars,
+    JFIELD(scalars, i, JF_INT),
+    JFIELD(scalars, f, JF_NUM),
+    JFIELD(scalars, b, JF_BOOL),
+    JFIELD(scalars, chars, JF_CHARS),
+    JFIELD(scalars, s, JF_STR))
+
+// Decodes string literal
+#define decode(name, string, object) \
+    name##_decode(string, sizeof(string) - 1, object)
+
+// Preset members of nested struct whose keys are absent survive a failed decode
+static bool test_preset_nested(void) {
+    static char label[] = "preset";
+    outer out = {0, "name", {0, label, NULL}};
+
+    check(!decode(outer, "{\"n\": 1, \"in\": {\"id\": 2}, \"name\": 3}", &out));
+    check(errno == EILSEQ);
+    check(out.in.label == label);
+    check(!strcmp(out.name, "name"));
+    out.in.label = NULL;
+    check(!decode(outer, "{\"in\": {\"extra\": [1, 2]}}", &out));   // n is required
+    check(errno == EILSEQ);
+    check(!out.in.label && !out.in.extra);
+    return true;
+}
+
+// Members allocated before a failure are freed, at every depth
+static bool test_failure_frees(void) {
+    outer out = {0};
+
+    check(!decode(outer, "{\"name\": \"x\", \"in\": {\"label\": \"y\", \"extra\": {}}, \"n\": }", &out));
+    check(!out.name && !out.in.label && !out.in.extra);
+    return true;
+}
+
+// Repeated keys keep the last value, freeing only what the decoder allocated
+static bool test_repeated_keys(void) {
+    static char label[] = "preset";
+    outer out = {0, NULL, {0, label, NULL}};
+
+    check(decode(outer, "{\"n\": 1, \"in\": {\"id\": 1}, \"in\": {\"id\": 2}}", &out));
+    check(out.in.id == 2 && out.in.label == label);
+    check(decode(outer, "{\"n\": 1, \"in\": {\"label\": \"a\"}, \"in\": {\"id\": 3}}", &out));
+    check(out.in.id == 3 && !out.in.label);
+    check(decode(outer, "{\"n\": 1, \"name\": \"a\", \"name\": \"b\"}", &out));
+    check(!strcmp(out.name, "b"));
+    outer_free(&out);
+    check(!out.name);
+    return true;
+}
+
+// Decoded fields of more nested structs than fit on the stack are tracked
+static bool test_wide(void) {
+    static char label[] = "preset";
+    wide object = {0};
+
+    object.q.label = label;
+    check(!decode(wide, "{\"a\": {\"label\": \"x\"}, \"p\": {\"label\": \"y\"}, \"q\": 1}", &object));
+    check(!object.a.label && !object.p.label && object.q.label == label);
+    return true;
+}
+
+// Members whose values are out of range or malformed keep their previous values
+static bool test_failed_member(void) {
+    static char preset[] = "preset";
+    scalars object = {7, 2.5, true, "abc", preset};
+
+    check(!decode(scalars, "{\"i\": 9223372036854775808}", &object) && errno == ERANGE);
+    check(object.i == 7);
+    check(!decode(scalars, "{\"i\": -9223372036854775809}", &object) && errno == ERANGE);
+    check(object.i == 7);
+    check(!decode(scalars, "{\"i\": 1e19}", &object) && errno == ERANGE);
+    check(object.i == 7);
+    check(!decode(scalars, "{\"f\": 1e999}", &object) && errno == ERANGE);
+    check(object.f == 2.5);
+    check(!decode(scalars, "{\"b\": fals}", &object) && errno == EILSEQ);
+    check(object.b);
+    check(!decode(scalars, "{\"chars\": \"x\\q\"}", &object) && errno == EILSEQ);
+    check(!strcmp(object.chars, "abc"));
+    check(!decode(scalars, "{\"chars\": \"\\u0041bcdefgh\"}", &object) && errno == ERANGE);
+    check(!strcmp(object.chars, "abc"));
+    check(!decode(scalars, "{\"s\": nul}", &object) && errno == EILSEQ);
+    check(object.s == preset);
+    check(decode(scalars, "{\"i\": 9223372036854775807, \"f\": 1e300, \"chars\": \"\\u0041\"}", &object));
+    check(object.i == 9223372036854775807 && object.f == 1e300 && !strcmp(object.chars, "A"));
+    return true;
+}
+
+test_main(test_preset_nested, test_failure_frees, test_repeated_keys, test_wide,
+  test_failed_member)
@@ -0,0 +1,162 @@
+// Tests for publishing, reading and reclaiming versions of a shared object
+#include <pthread.h>
+#include <stdatomic.h>
+#include "../json.h"
+#include "check.h"
+
+// Versions published by the writer of the threaded test
+#define SHARED_VERSIONS 2000
+
+// Threads reading while versions are published
+#define SHARED_READERS  4
+
+// Returns object {"v": n, "w": n}, or NULL on error
+static json_t *version(long n) {
+    json_t *json = json_new();
+    const jvalue_t VALUE = {.type = J_NUM, .value = {.number = (jfloat_t) n}};
+
+    if (json && json_add(json, "v", &VALUE) && json_add(json, "w", &VALUE))
+        return json;
+    json_free(json);
+    return NULL;
+}
+
+// Returns number held by version, or -1 if its members disagree
+static long version_of(const json_t *json) {
+    const jvalue_t *v = json_find(json, "v"), *w = json_find(json, "w");
+
+    if (!v || !w || v->value.number != w->value.number)
+        return -1;
+    return (long) v->value.number;
+}
+
+// Publishing NULL leaves readers without a current version until another is published
+static bool test_publish_null(void) {
+    jshared_t *shared = jshared_new(version(1));
+    jreader_t *reader = shared ? jshared_register(shared) : NULL;
+
+    check(reader);
+    check(version_of(jshared_enter(reader)) == 1);
+    jshared_leave(reader);
+    check(jshared_publish(shared, NULL));
+    check(!jshared_enter(reader));
+    jshared_leave(reader);
+    check(jshared_reclaim(shared) == 1);
+    check(jshared_publish(shared, NULL));   // Replaces nothing
+    check(jshared_reclaim(shared) == 0);
+    check(jshared_publish(shared, version(2)));
+    check(version_of(jshared_enter(reader)) == 2);
+    jshared_leave(reader);
+    jshared_unregister(reader);
+    jshared_free(shared);
+    return true;
+}
+
+// A version replaced while being read survives until the reader leaves
+static bool test_live_reader(void) {
+    jshared_t *shared = jshared_new(version(1));
+    jreader_t *reader = shared ? jshared_register(shared) : NULL, *idle;
+    const json_t *seen;
+
+    check(reader);
+    idle = jshared_register(shared);    // Registered, but not reading
+    check(idle);
+    seen = jshared_enter(reader);
+    check(jshared_publish(shared, version(2)));
+    check(jshared_publish(shared, version(3)));
+    check(jshared_reclaim(shared) == 0);
+    check(version_of(seen) == 1);       // Still valid
+    jshared_leave(reader);
+    check(jshared_reclaim(shared) == 2);
+    check(jshared_reclaim(shared) == 0);
+    check(version_of(jshared_enter(reader)) == 3);
+    jshared_leave(reader);
+    jshared_unregister(reader);
+    jshared_unregister(idle);
+    jshared_free(shared);
+    return true;
+}
+
+// Unregistered readers are handed out again before new ones are allocated
+static bool test_reader_reuse(void) {
+    jshared_t *shared = jshared_new(version(1));
+    jreader_t *first = shared ? jshared_register(shared) : NULL, *second, *third, *fourth;
+
+    check(first);
+    jshared_unregister(first);
+    second = jshared_register(shared);
+    check(second == first);
+    third = jshared_register(shared);   // first is owned again
+    check(third && third != first);
+    jshared_unregister(second);
+    jshared_unregister(third);
+    second = jshared_register(shared);
+    fourth = jshared_register(shared);
+    check(second && fourth && second != fourth);
+    check(second == first || second == third);  // Both reused, in either order
+    check(fourth == first || fourth == third);
+    jshared_unregister(second);
+    jshared_unregister(fourth);
+    jshared_free(shared);
+    return true;
+}
+
+typedef struct reader_arg {
+    jshared_t *shared;
+    atomic_bool *done;
+    bool failed;
+} reader_arg;
+
+// Reads versions until the writer is done, checking that each is whole
+static void *reader_main(void *arg) {
+    reader_arg *const ARG = arg;
+    jreader_t *reader = jshared_register(ARG->shared);
+    long last = 0;
+
+    ARG->failed = !reader;
+    while (reader && !atomic_load(ARG->done)) {
+        const long SEEN = version_of(jshared_enter(reader));
+
+        if (SEEN < last) {  // Torn, freed or older than one seen before
+            ARG->failed = true;
+            break;
+        }
+        last = SEEN;
+        jshared_leave(reader);
+    }
+    if (reader)
+        jshared_unregister(reader);
+    return NULL;
+}
+
+// Readers on several threads observe whole versions while a writer publishes and reclaims
+static bool test_threads(void) {
+    jshared_t *shared = jshared_new(version(0));
+    pthread_t threads[SHARED_READERS];
+    reader_arg args[SHARED_READERS];
+    atomic_bool done = false;
+    size_t started = 0, reclaimed = 0;
+    bool success = shared;
+
+    for (; success && started < SHARED_READERS; ++started) {
+        args[started] = (reader_arg) {shared, &done, false};
+        success = !pthread_create(&threads[started], NULL, reader_main, &args[started]);
+    }
+    for (long n = 1; success && n <= SHARED_VERSIONS; ++n) {
+        success = jshared_publish(shared, version(n));
+        if (n % 16 == 0)
+            reclaimed += jshared_reclaim(shared);
+    }
+    atomic_store(&done, true);
+    for (size_t i = 0; i < started; ++i) {
+        pthread_join(threads[i], NULL);
+        success = success && !args[i].failed;
+    }
+    check(success);
+    reclaimed += jshared_reclaim(shared);
+    check(reclaimed == SHARED_VERSIONS);    // Every replaced version, once unobserved
+    jshared_free(shared);
+    return true;
+}
+
+test_main(test_publish_null, test_live_reader, test_reader_reuse, test_threads)
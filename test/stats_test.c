@@ -0,0 +1,74 @@
+// Tests for memory accounting, built with JSON_STATS defined
+#include <string.h>
+#include "../json.h"
+#include "check.h"
+
+// Members of the string-heavy object, and length of each of their values
+#define STRING_MEMBERS  32
+#define STRING_LEN      200
+
+// Returns true if no byte is counted as held
+static bool holds_nothing(jmemory_t held) {
+    return !held.entries && !held.values && !held.strings && !held.arrays && !held.objects;
+}
+
+// Returns total of byte counts
+static size_t total(jmemory_t usage) {
+    return usage.entries + usage.values + usage.strings + usage.arrays + usage.objects;
+}
+
+/* Writes object whose members hold long strings to text, of given size
+ * Returns length of object */
+static size_t strings(char *text, size_t size) {
+    size_t len = snprintf(text, size, "{");
+
+    for (int i = 0; i < STRING_MEMBERS && len < size; ++i) {
+        len += snprintf(text + len, size - len, "%s\"key%02d\": \"", i ? ", " : "", i);
+        for (int j = 0; j < STRING_LEN && len < size; ++j)
+            text[len++] = 'a' + (i + j) % 26;
+        len += snprintf(text + len, len < size ? size - len : 0, "\"");
+    }
+    len += snprintf(text + len, len < size ? size - len : 0, "}");
+    return len;
+}
+
+// Every allocation made while parsing is released when the object is freed
+static bool test_parse_free(void) {
+    json_t *json = parse("{\"a\": [1, \"two\", {\"b\": null}], \"c\": {\"d\": [[]], \"e\": \"f\"}}");
+    jstats_t stats;
+
+    check(json);
+    stats = json_stats();
+    check(stats.allocs > stats.frees && !holds_nothing(stats.held));
+    json_free(json);
+    stats = json_stats();
+    check(stats.allocs == stats.frees);
+    check(holds_nothing(stats.held));
+    return true;
+}
+
+// Bytes held by an object are at least those of its text, when it is mostly strings
+static bool test_memory_usage(void) {
+    char text[STRING_MEMBERS * (STRING_LEN + 16) + 2];
+    const size_t LEN = strings(text, sizeof text);
+    json_t *json;
+    jmemory_t usage = {0};
+
+    check(LEN < sizeof text);
+    json = parse(text);
+    check(json);
+
+    const jvalue_t VALUE = {.type = J_OBJ, .value = {.object = json}};
+    const size_t BYTES = jvalue_memory_usage(&VALUE, &usage);
+
+    check(BYTES >= LEN);
+    check(usage.strings >= STRING_MEMBERS * (STRING_LEN + 1));
+    check(total(usage) <= BYTES);
+    check(total(json_stats().held) <= BYTES);   // VALUE itself was not allocated
+    json_free(json);
+    check(json_stats().allocs == json_stats().frees);
+    check(holds_nothing(json_stats().held));
+    return true;
+}
+
+test_main(test_parse_free, test_memory_usage)
@@ -0,0 +1,53 @@
+// Tests for validation without parsing
+#include <errno.h>
+#include <stdint.h>
+#include "../json.h"
+#include "check.h"
+
+// Validates string literal, without its terminator
+#define validate(literal, offset) json_validate(literal, sizeof(literal) - 1, offset)
+
+// Returns true if validation of literal fails at the given offset
+#define rejects_at(literal, expected) \
+    (!validate(literal, &offset) && errno == EILSEQ && offset == (expected))
+
+static bool test_accepts(void) {
+    size_t offset = SIZE_MAX;
+
+    check(validate("{}", &offset));
+    check(validate(" [1, -0.5e+3, true, false, null] ", &offset));
+    check(validate("{\"a\": {\"b\": [\"\\u00e9\\ud83d\\ude00\", \"\xE6\x97\xA5\"]}}", &offset));
+    check(validate("\"plain\"", &offset));
+    check(offset == SIZE_MAX);  // Left untouched on success
+    return true;
+}
+
+static bool test_number_offsets(void) {
+    size_t offset;
+
+    check(rejects_at("{\"a\":1.}", 7));     // Fraction without digits
+    check(rejects_at("{\"a\":1e}", 7));     // Exponent without digits
+    check(rejects_at("{\"a\":1e+}", 8));
+    check(rejects_at("[-]", 2));            // Sign without digits
+    check(rejects_at("[-x]", 2));
+    check(rejects_at("[01]", 2));           // Leading zero
+    check(rejects_at("[.5]", 1));
+    return true;
+}
+
+static bool test_other_offsets(void) {
+    size_t offset;
+
+    check(rejects_at("[tru]", 4));          // Literal cut short
+    check(rejects_at("[nul1]", 4));
+    check(rejects_at("{\"a\" 1}", 5));      // Missing colon
+    check(rejects_at("[1 2]", 3));          // Missing comma
+    check(rejects_at("[1]]", 3));           // Trailing characters
+    check(rejects_at("[\"a\tb\"]", 3));     // Control character in string
+    check(rejects_at("[\"\\x\"]", 2));      // Invalid escape
+    check(rejects_at("[\"\xC3\"]", 2));     // Truncated UTF-8
+    check(rejects_at("[\"abc", 5));         // Unterminated string
+    return true;
+}
+
+test_main(test_accepts, test_number_offsets, test_other_offsets)